@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+"""Builds and runs the benchmarks under several compilers and flag sets.
+
+For every compiler and variant there is a build directory in --build_root
+(configured with the BENCHMARKS_* options of benchmarks/CMakeLists.txt)
+and a result directory in --output_dir. The variants are:
+
+  O2      -O2
+  O3      -O3
+  native  -O3 -march=native
+  pgo     -O3, built instrumented, trained on the same benchmarks, then
+          rebuilt with the profiles
+
+Then for every problem the fastest strategy is tabulated per variant.
+A problem is a benchmark binary, a family of benchmarks that solve the
+same thing and the arguments, see FAMILY_RULES for how a benchmark name
+splits into them. Strategies that are aliases of others, see ALIASES, are
+left out. Problems where the variants disagree are marked, a strategy
+that only wins with one compiler is no recommendation.
+
+  benchmark_matrix.py --targets flat_set_insert_benchmark \\
+      --benchmark_args='--benchmark_filter=^mixed_ --benchmark_repetitions=5'
+
+A compiler that is not installed is skipped. --tabulate_only redraws the
+table from the results that are already there.
+"""
+
+import argparse
+import glob
+import os
+import re
+import shlex
+import shutil
+import subprocess
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, SCRIPT_DIR)
+
+import compare_benchmarks
+import run_benchmarks
+
+VARIANTS = {
+    'O2': ['-DBENCHMARKS_OPT_LEVEL=O2'],
+    'O3': ['-DBENCHMARKS_OPT_LEVEL=O3'],
+    'native': ['-DBENCHMARKS_OPT_LEVEL=O3', '-DBENCHMARKS_NATIVE=ON'],
+    'pgo': ['-DBENCHMARKS_OPT_LEVEL=O3'],
+}
+VARIANT_ORDER = ['O2', 'O3', 'native', 'pgo']
+
+# target -> [(family, pattern)], the first pattern that matches a benchmark
+# name wins. The pattern has a 'strategy' group and maybe an 'args' group,
+# the family is formatted with all of its groups. Then come GENERIC_RULES.
+FAMILY_RULES = {
+    'flat_set_insert_benchmark': [
+        ('{family}', r'(?P<family>mixed|dense|compressed_lookup|'
+                     r'compressed_bulk_insert)_(?P<strategy>\w+)/(?P<args>.*)'),
+        ('bulk_insert', r'(?P<strategy>\w+)/(?P<args>.*)'),
+    ],
+    # operation/container/key/size
+    'container_matrix_benchmark': [
+        ('{family}', r'(?P<family>[^/]+)/(?P<strategy>[^/]+)/(?P<args>.*)'),
+    ],
+    'nth_element_benchmark': [
+        ('nth_element', r'benchmark_(?P<strategy>empty|only_first|'
+                        r'compare_all_\w+)'),
+        ('arithmetic<{type}>', r'benchmark_arithmetic_(?P<strategy>\w+)'
+                               r'<(?P<type>[^>]+)>/(?P<args>.*)'),
+        ('top_k', r'benchmark_top_k_(?P<strategy>\w+)/(?P<args>.*)'),
+        ('stream_top_k', r'benchmark_stream_(?P<strategy>\w*top_k\w*)'
+                         r'/(?P<args>.*)'),
+        ('stream_quantile', r'benchmark_stream_(?P<strategy>\w*quantile\w*)'
+                            r'/(?P<args>.*)'),
+    ],
+}
+
+# For every target: family<strategy>/args, then strategy/args.
+GENERIC_RULES = [
+    ('{family}', r'(?P<family>[^<>/]+)<(?P<strategy>[^/]+)>(?:/(?P<args>.*))?'),
+    ('', r'(?P<strategy>[^/]+)(?:/(?P<args>.*))?'),
+]
+
+# target -> {(family, strategy): the strategy it runs the same code as}.
+ALIASES = {
+    'flat_set_insert_benchmark': {
+        ('bulk_insert', 'boost_and_eastl_solution'): 'benchmark_one_at_a_time',
+        ('bulk_insert', 'folly_solution'): 'benchmark_full_inplace_merge',
+        ('bulk_insert', 'chromium_solution'):
+            'benchmark_copy_unique_inplace_merge_cache_begin',
+        ('bulk_insert', 'proposed_solution'):
+            'benchmark_use_end_buffer_precise',
+    },
+}
+
+def check(command, cwd=None):
+  sys.stdout.write('$ %s\n' % ' '.join(command))
+  sys.stdout.flush()
+  if subprocess.call(command, cwd=cwd) != 0:
+    raise RuntimeError('failed: %s' % ' '.join(command))
+
+def configure(build_dir, compiler, flags):
+  if not os.path.isdir(build_dir):
+    os.makedirs(build_dir)
+  check(['cmake', SCRIPT_DIR, '-DCMAKE_BUILD_TYPE=Release',
+         '-DCMAKE_CXX_COMPILER=' + compiler] + flags, cwd=build_dir)
+
+def build(build_dir, targets, jobs):
+  for target in targets:
+    check(['cmake', '--build', build_dir, '--target', target,
+           '--', '-j%d' % jobs])
+
+def binaries(build_dir, targets):
+  return [os.path.join(build_dir, 'benchmarks', t) for t in targets]
+
+def runAll(build_dir, targets, output_dir, benchmark_args):
+  if not os.path.isdir(output_dir):
+    os.makedirs(output_dir)
+  failed = [b for b in binaries(build_dir, targets)
+            if not run_benchmarks.runBenchmark(b, output_dir, benchmark_args)]
+  if failed:
+    raise RuntimeError('failed: %s' % ', '.join(failed))
+
+def isClang(compiler):
+  output = subprocess.check_output([compiler, '--version'])
+  return b'clang' in output
+
+# clang writes raw profiles that have to be merged into the file
+# -fprofile-use reads, gcc uses its .gcda files as they are.
+def mergeClangProfiles(pgo_dir, compiler):
+  profdata = shutil.which('llvm-profdata')
+  version = os.path.basename(compiler).partition('-')[2]
+  if version and shutil.which('llvm-profdata-' + version):
+    profdata = shutil.which('llvm-profdata-' + version)
+  if not profdata:
+    raise RuntimeError('llvm-profdata is needed for clang pgo')
+  check([profdata, 'merge', '-o', os.path.join(pgo_dir, 'default.profdata')] +
+        glob.glob(os.path.join(pgo_dir, '*.profraw')))
+
+def buildAndRun(compiler, variant, options, benchmark_args):
+  name = '%s-%s' % (options.compiler_names[compiler], variant)
+  build_dir = os.path.abspath(os.path.join(options.build_root, name))
+  output_dir = os.path.join(options.output_dir, name)
+  flags = VARIANTS[variant]
+
+  if variant == 'pgo':
+    # Reconfigured in place: gcc names the profiles after the object files.
+    pgo_dir = os.path.join(build_dir, 'pgo')
+    shutil.rmtree(pgo_dir, ignore_errors=True)
+    pgo_flags = flags + ['-DBENCHMARKS_PGO_DIR=' + pgo_dir]
+    configure(build_dir, compiler, pgo_flags + ['-DBENCHMARKS_PGO=GENERATE'])
+    build(build_dir, options.targets, options.jobs)
+    runAll(build_dir, options.targets, os.path.join(output_dir, 'training'),
+           benchmark_args)
+    if isClang(compiler):
+      mergeClangProfiles(pgo_dir, compiler)
+    flags = pgo_flags + ['-DBENCHMARKS_PGO=USE']
+  else:
+    flags = flags + ['-DBENCHMARKS_PGO=OFF']
+
+  configure(build_dir, compiler, flags)
+  build(build_dir, options.targets, options.jobs)
+  runAll(build_dir, options.targets, output_dir, benchmark_args)
+
+# (family, strategy, arguments) of a benchmark name.
+def splitName(target, name):
+  for family, pattern in FAMILY_RULES.get(target, []) + GENERIC_RULES:
+    match = re.match(pattern + '$', name)
+    if match:
+      groups = match.groupdict()
+      return (family.format(**groups), groups['strategy'],
+              groups.get('args') or '')
+  raise ValueError('cannot split benchmark name %s' % name)
+
+# (target, family, arguments) -> strategy -> median time in ns.
+def loadProblems(result_dir, metric, exclude, keep_aliases):
+  problems = {}
+  for path in sorted(glob.glob(os.path.join(result_dir, '*.json'))):
+    if os.path.getsize(path) == 0:
+      continue
+    target = run_benchmarks.benchmarkName(path)
+    aliases = {} if keep_aliases else ALIASES.get(target, {})
+    times = compare_benchmarks.loadTimes(path, metric, None)
+    for name, ts in times.items():
+      family, strategy, arguments = splitName(target, name)
+      if strategy in exclude or (family, strategy) in aliases:
+        continue
+      problem = problems.setdefault((target, family, arguments), {})
+      problem[strategy] = compare_benchmarks.median(ts)
+  return problems
+
+# Winner and how much faster it is than the second best.
+def winner(strategies):
+  ranked = sorted(strategies.items(), key=lambda x: x[1])
+  if len(ranked) < 2:
+    return None
+  return (ranked[0][0], ranked[1][1] / ranked[0][1] - 1)
+
+def tabulate(columns, options, out):
+  results = {}
+  for column in columns:
+    result_dir = os.path.join(options.output_dir, column)
+    results[column] = loadProblems(result_dir, options.metric,
+                                   options.exclude, options.keep_aliases)
+
+  all_problems = sorted(set(p for r in results.values() for p in r))
+  headers = ['problem'] + columns + ['']
+  rows = []
+  wins = dict((column, {}) for column in columns)
+  disagreements = 0
+  for problem in all_problems:
+    row = [' '.join(p for p in problem if p)]
+    winners = set()
+    for column in columns:
+      w = winner(results[column].get(problem, {}))
+      if not w:
+        row.append('-')
+        continue
+      winners.add(w[0])
+      wins[column][w[0]] = wins[column].get(w[0], 0) + 1
+      row.append('%s +%.0f%%' % (w[0], w[1] * 100))
+    if len(winners) > 1:
+      disagreements += 1
+      row.append('DIFFERS')
+    else:
+      row.append('')
+    rows.append(row)
+
+  if not rows:
+    out.write('no results in %s\n' % options.output_dir)
+    return
+
+  widths = [max(len(r[i]) for r in rows + [headers])
+            for i in range(len(headers))]
+  def line(cells):
+    return '  '.join(cell.ljust(w) for cell, w in zip(cells, widths)).rstrip()
+
+  out.write('Fastest strategy by %s, +N%% is the lead over the second\n'
+            % options.metric)
+  out.write(line(headers) + '\n')
+  out.write(line(['-' * w for w in widths]) + '\n')
+  for r in rows:
+    out.write(line(r) + '\n')
+  out.write('%d problems, the winner differs in %d\n\n' %
+            (len(rows), disagreements))
+
+  out.write('Wins per strategy\n')
+  for column in columns:
+    ranked = sorted(wins[column].items(), key=lambda x: (-x[1], x[0]))
+    out.write('%s: %s\n' % (column, ', '.join('%s %d' % w for w in ranked)))
+
+if __name__ == '__main__':
+  options_parser = argparse.ArgumentParser(
+      description='Runs the benchmarks under every compiler and flag set.')
+  options_parser.add_argument('--compilers', nargs='+',
+                              default=['gcc=g++', 'clang=clang++'],
+                              help='name=compiler')
+  options_parser.add_argument('--variants', nargs='+', default=VARIANT_ORDER,
+                              choices=VARIANT_ORDER)
+  options_parser.add_argument('--targets', nargs='+',
+                              default=['flat_set_insert_benchmark'],
+                              help='benchmark targets to build and run')
+  options_parser.add_argument('--benchmark_args', default='',
+                              help='passed to every binary, split like a '
+                                   'shell would')
+  options_parser.add_argument('--build_root', default='build_matrix')
+  options_parser.add_argument('--output_dir', default='matrix_results')
+  options_parser.add_argument('--jobs', type=int, default=os.cpu_count())
+  options_parser.add_argument('--metric', default='real_time',
+                              choices=['real_time', 'cpu_time'])
+  options_parser.add_argument('--exclude', nargs='*',
+                              default=['baseline', 'empty'],
+                              help='strategies left out of the table')
+  options_parser.add_argument('--keep_aliases', action='store_true',
+                              help='tabulate the strategies in ALIASES too')
+  options_parser.add_argument('--tabulate_only', action='store_true')
+  options = options_parser.parse_args()
+
+  compilers = []
+  options.compiler_names = {}
+  for c in options.compilers:
+    name, _, compiler = c.rpartition('=')
+    name = name or os.path.basename(compiler)
+    if not options.tabulate_only and not shutil.which(compiler):
+      sys.stderr.write('%s not found, skipping %s\n' % (compiler, name))
+      continue
+    compilers.append(compiler)
+    options.compiler_names[compiler] = name
+
+  columns = ['%s-%s' % (options.compiler_names[c], v)
+             for c in compilers for v in options.variants]
+  failed = []
+  if not options.tabulate_only:
+    benchmark_args = shlex.split(options.benchmark_args)
+    for compiler in compilers:
+      for variant in options.variants:
+        try:
+          buildAndRun(compiler, variant, options, benchmark_args)
+        except (RuntimeError, OSError, subprocess.CalledProcessError) as e:
+          sys.stderr.write('%s\n' % e)
+          failed.append('%s-%s' % (options.compiler_names[compiler], variant))
+  columns = [c for c in columns
+             if os.path.isdir(os.path.join(options.output_dir, c))]
+
+  if not os.path.isdir(options.output_dir):
+    os.makedirs(options.output_dir)
+  with open(os.path.join(options.output_dir, 'summary.txt'), 'w') as summary:
+    tabulate(columns, options, summary)
+  with open(os.path.join(options.output_dir, 'summary.txt')) as summary:
+    sys.stdout.write(summary.read())
+  sys.exit(1 if failed else 0)
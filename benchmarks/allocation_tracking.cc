@@ -0,0 +1,254 @@
+#include "benchmarks/allocation_tracking.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || \
+    __has_feature(memory_sanitizer)
+#define ALLOCATION_TRACKING_SANITIZER
+#endif
+#endif
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define ALLOCATION_TRACKING_SANITIZER
+#endif
+
+// glibc lets a program replace malloc and still call its own under the
+// __libc_ names. Elsewhere only operator new is tracked.
+#if defined(__GLIBC__) && !defined(ALLOCATION_TRACKING_SANITIZER)
+#define ALLOCATION_TRACKING_MALLOC
+#endif
+
+#if !defined(ALLOCATION_TRACKING_SANITIZER)
+#define ALLOCATION_TRACKING_NEW
+#endif
+
+#ifdef ALLOCATION_TRACKING_MALLOC
+#include <malloc.h>
+
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t n, std::size_t size);
+void* __libc_realloc(void* p, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void* p);
+}
+#endif
+
+namespace {
+
+// Constant initialized, so they work for allocations before main.
+std::atomic<std::size_t> g_allocations{0};
+std::atomic<std::size_t> g_allocated_bytes{0};
+std::atomic<std::size_t> g_live_bytes{0};
+std::atomic<std::size_t> g_peak_live_bytes{0};
+
+std::size_t usable_size(void* p) {
+#ifdef ALLOCATION_TRACKING_MALLOC
+  return ::malloc_usable_size(p);
+#else
+  (void)p;
+  return 0;
+#endif
+}
+
+void add_live(std::size_t size) {
+  const auto live =
+      g_live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  auto peak = g_peak_live_bytes.load(std::memory_order_relaxed);
+  while (live > peak &&
+         !g_peak_live_bytes.compare_exchange_weak(peak, live,
+                                                  std::memory_order_relaxed)) {
+  }
+}
+
+void* record_allocation(void* p, std::size_t size) {
+  if (!p)
+    return p;
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  add_live(usable_size(p));
+  return p;
+}
+
+void record_free(void* p) {
+  if (p)
+    g_live_bytes.fetch_sub(usable_size(p), std::memory_order_relaxed);
+}
+
+}  // namespace
+
+namespace helpers {
+namespace allocation_tracking {
+
+bool enabled() {
+#ifdef ALLOCATION_TRACKING_NEW
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::size_t allocations() {
+  return g_allocations.load(std::memory_order_relaxed);
+}
+
+std::size_t allocated_bytes() {
+  return g_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+std::size_t live_bytes() {
+  return g_live_bytes.load(std::memory_order_relaxed);
+}
+
+std::size_t peak_live_bytes() {
+  return g_peak_live_bytes.load(std::memory_order_relaxed);
+}
+
+void reset_peak() {
+  g_peak_live_bytes.store(live_bytes(), std::memory_order_relaxed);
+}
+
+}  // namespace allocation_tracking
+}  // namespace helpers
+
+#ifdef ALLOCATION_TRACKING_MALLOC
+
+extern "C" {
+
+void* malloc(std::size_t size) {
+  return record_allocation(__libc_malloc(size), size);
+}
+
+void* calloc(std::size_t n, std::size_t size) {
+  return record_allocation(__libc_calloc(n, size), n * size);
+}
+
+void* realloc(void* p, std::size_t size) {
+  // A failed realloc keeps the old block.
+  const std::size_t old_size = p ? usable_size(p) : 0;
+  void* res = __libc_realloc(p, size);
+  if (!res && size != 0)
+    return res;
+  g_live_bytes.fetch_sub(old_size, std::memory_order_relaxed);
+  if (!res)
+    return res;
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  add_live(usable_size(res));
+  return res;
+}
+
+void* memalign(std::size_t alignment, std::size_t size) {
+  return record_allocation(__libc_memalign(alignment, size), size);
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** res, std::size_t alignment, std::size_t size) {
+  if (alignment % sizeof(void*) != 0 ||
+      (alignment & (alignment - 1)) != 0)
+    return EINVAL;
+  void* p = memalign(alignment, size);
+  if (!p)
+    return ENOMEM;
+  *res = p;
+  return 0;
+}
+
+void free(void* p) {
+  record_free(p);
+  __libc_free(p);
+}
+
+}  // extern "C"
+
+#endif  // ALLOCATION_TRACKING_MALLOC
+
+#ifdef ALLOCATION_TRACKING_NEW
+
+// With the malloc hooks these only have to get to malloc, without them they
+// record the allocation themselves.
+namespace {
+
+void* tracked_new(std::size_t size) {
+  if (size == 0)
+    size = 1;
+  while (true) {
+    void* p = std::malloc(size);
+#ifndef ALLOCATION_TRACKING_MALLOC
+    record_allocation(p, size);
+#endif
+    if (p)
+      return p;
+    auto handler = std::get_new_handler();
+    if (!handler)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+void tracked_delete(void* p) {
+#ifndef ALLOCATION_TRACKING_MALLOC
+  record_free(p);
+#endif
+  std::free(p);
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  return tracked_new(size);
+}
+
+void* operator new[](std::size_t size) {
+  return tracked_new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return tracked_new(size);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return tracked_new(size);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+
+void operator delete(void* p) noexcept {
+  tracked_delete(p);
+}
+
+void operator delete[](void* p) noexcept {
+  tracked_delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  tracked_delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+  tracked_delete(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+  tracked_delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+  tracked_delete(p);
+}
+
+#endif  // ALLOCATION_TRACKING_NEW
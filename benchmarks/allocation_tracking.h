@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+
+namespace helpers {
+
+// Heap traffic of the whole process, recorded by allocation_tracking.cc,
+// which has to be linked into the binary. It replaces operator new and,
+// with glibc, malloc; a sanitizer build, that has its own, leaves it off.
+namespace allocation_tracking {
+
+bool enabled();
+
+std::size_t allocations();
+// As requested, not what malloc rounded it up to.
+std::size_t allocated_bytes();
+// The live and peak bytes are usable sizes, allocator overhead included.
+std::size_t live_bytes();
+std::size_t peak_live_bytes();
+// The peak starts again from the bytes live now.
+void reset_peak();
+
+}  // namespace allocation_tracking
+
+struct allocation_stats {
+  std::size_t allocations = 0;
+  std::size_t bytes = 0;
+  // Above what was live at the start, 0 without the malloc hooks.
+  std::size_t peak_live_bytes = 0;
+};
+
+// Heap traffic from its construction on. Tracks the peak of the whole
+// process, so only one can be alive at a time.
+//
+//   allocation_tracker allocations;
+//   while (state.KeepRunning()) { ... }
+//   allocations.report(state);
+class allocation_tracker {
+ public:
+  allocation_tracker()
+      : start_allocations_(allocation_tracking::allocations()),
+        start_bytes_(allocation_tracking::allocated_bytes()),
+        start_live_bytes_(allocation_tracking::live_bytes()) {
+    allocation_tracking::reset_peak();
+  }
+
+  allocation_stats stats() const {
+    allocation_stats res;
+    res.allocations = allocation_tracking::allocations() - start_allocations_;
+    res.bytes = allocation_tracking::allocated_bytes() - start_bytes_;
+    const auto peak = allocation_tracking::peak_live_bytes();
+    if (peak > start_live_bytes_)
+      res.peak_live_bytes = peak - start_live_bytes_;
+    return res;
+  }
+
+  // Allocations and bytes per iteration and the peak of all of them, as
+  // counters of a benchmark::State. Nothing without tracking.
+  template <typename State>
+  void report(State& state) const {
+    const auto iterations = static_cast<double>(state.iterations());
+    if (!allocation_tracking::enabled() || iterations == 0)
+      return;
+    const auto res = stats();
+    state.counters["heap_allocations"] =
+        static_cast<double>(res.allocations) / iterations;
+    state.counters["heap_bytes"] = static_cast<double>(res.bytes) / iterations;
+    state.counters["heap_peak_bytes"] =
+        static_cast<double>(res.peak_live_bytes);
+  }
+
+ private:
+  std::size_t start_allocations_;
+  std::size_t start_bytes_;
+  std::size_t start_live_bytes_;
+};
+
+// Heap traffic of one op() call, for benchmarks that time op on a ring of
+// inputs (see input_ring.h): a tracker around that loop counts the refills
+// too, and its peak is every input of the ring grown at once. Same counters
+// as allocation_tracker::report.
+template <typename State, typename Op>
+void report_allocations_of_one(State& state, Op op) {
+  if (!allocation_tracking::enabled())
+    return;
+  const allocation_tracker tracker;
+  op();
+  const auto res = tracker.stats();
+  state.counters["heap_allocations"] = static_cast<double>(res.allocations);
+  state.counters["heap_bytes"] = static_cast<double>(res.bytes);
+  state.counters["heap_peak_bytes"] =
+      static_cast<double>(res.peak_live_bytes);
+}
+
+}  // namespace helpers
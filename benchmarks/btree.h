@@ -0,0 +1,530 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/comparators.h"
+#include "benchmarks/insert_algorithms.h"
+
+namespace helpers {
+namespace btree {
+
+// Nodes take a few cache lines, like absl::btree_set.
+constexpr size_t c_node_bytes = 256;
+
+// A bulk insert that adds at least size / ratio elements rebuilds the tree
+// instead of inserting one by one.
+constexpr size_t c_rebuild_ratio = 8;
+
+// Odd, so that a full node splits into two equal halves around the median.
+template <typename T>
+constexpr size_t max_keys() {
+  return (std::max<size_t>(c_node_bytes / sizeof(T), 4) - 1) | 1;
+}
+
+template <typename T, size_t N>
+struct node {
+  explicit node(bool leaf) : leaf(leaf) {}
+
+  const bool leaf;
+  size_t size = 0;
+  T keys[N];
+};
+
+template <typename T, size_t N>
+struct inner_node : node<T, N> {
+  inner_node() : node<T, N>(false) {}
+
+  node<T, N>* children[N + 1];
+};
+
+template <typename T, typename P>
+constexpr bool use_linear_search_v =
+    is_trivially_comparable_v<T> &&
+    (std::is_same<P, std::less<>>::value ||
+     std::is_same<P, std::less<T>>::value);
+
+// Counting is branch free and vectorizes, for a node worth of arithmetic keys
+// that beats binary search.
+template <typename T, typename P>
+std::enable_if_t<use_linear_search_v<T, P>, size_t>
+lower_bound_in_node(const T* keys, size_t size, const T& key, P) {
+  size_t res = 0;
+  for (size_t i = 0; i < size; ++i)
+    res += keys[i] < key;
+  return res;
+}
+
+// Everything else uses the galloping search of the flat set algorithms: at
+// most about twice the comparisons of a binary search, fewer for keys close
+// to the front of the node.
+template <typename T, typename K, typename P>
+std::enable_if_t<!use_linear_search_v<T, P> || !std::is_same<T, K>::value,
+                 size_t>
+lower_bound_in_node(const T* keys, size_t size, const K& key, P p) {
+  return static_cast<size_t>(
+      helpers::lower_bound_biased(keys, keys + size, key, p) - keys);
+}
+
+}  // namespace btree
+}  // namespace helpers
+
+namespace containers {
+
+struct sorted_unique_t {};
+constexpr sorted_unique_t sorted_unique{};
+
+// In-memory B-tree set. Elements live in both inner nodes and leaves (so move
+// only types work, there are no separator copies), every node except the
+// root is at least half full. Insertion and erasure are single pass top-down,
+// splitting full nodes and refilling minimal ones on the way down.
+template <typename T, typename P = std::less<>>
+// requires StrictWeakOrdering<P, T> && DefaultConstructible<T>
+class btree_set {
+ public:
+  using value_type = T;
+
+  btree_set() = default;
+  explicit btree_set(P p) : p_(p) {}
+
+  // [f, l) has to be sorted and unique, builds the tree with full nodes in
+  // O(n).
+  template <typename I>
+  // requires ForwardIterator<I>
+  btree_set(sorted_unique_t, I f, I l, P p = P{}) : p_(p) {
+    build_sorted_unique(f, l);
+  }
+
+  btree_set(const btree_set& x)
+      : p_(x.p_), root_(x.root_ ? clone(x.root_) : nullptr), size_(x.size_) {}
+
+  btree_set(btree_set&& x) noexcept { swap(x); }
+
+  btree_set& operator=(btree_set x) noexcept {
+    swap(x);
+    return *this;
+  }
+
+  ~btree_set() { destroy(root_); }
+
+  void swap(btree_set& x) noexcept {
+    using std::swap;
+    swap(p_, x.p_);
+    swap(root_, x.root_);
+    swap(size_, x.size_);
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  void clear() {
+    btree_set tmp(p_);
+    swap(tmp);
+  }
+
+  // nullptr if there is no such element.
+  template <typename K>
+  const T* find(const K& key) const {
+    const node_t* x = root_;
+    while (x) {
+      const size_t i = lower_bound_in(x, key);
+      if (i < x->size && !p_(key, x->keys[i]))
+        return &x->keys[i];
+      if (x->leaf)
+        return nullptr;
+      x = child(x, i);
+    }
+    return nullptr;
+  }
+
+  template <typename K>
+  bool contains(const K& key) const {
+    return find(key) != nullptr;
+  }
+
+  std::pair<const T*, bool> insert(T value) {
+    if (!root_)
+      root_ = new node_t(true);
+    if (root_->size == c_max_keys) {
+      auto* new_root = new inner_t;
+      new_root->children[0] = root_;
+      root_ = new_root;
+      split_child(root_, 0);
+    }
+
+    node_t* x = root_;
+    while (true) {
+      size_t i = lower_bound_in(x, value);
+      if (i < x->size && !p_(value, x->keys[i]))
+        return {&x->keys[i], false};
+      if (x->leaf) {
+        insert_at(x, i, std::move(value));
+        ++size_;
+        return {&x->keys[i], true};
+      }
+      if (child(x, i)->size == c_max_keys) {
+        split_child(x, i);
+        if (p_(x->keys[i], value))
+          ++i;
+        else if (!p_(value, x->keys[i]))
+          return {&x->keys[i], false};
+      }
+      x = child(x, i);
+    }
+  }
+
+  template <typename... Args>
+  std::pair<const T*, bool> emplace(Args&&... args) {
+    return insert(T(std::forward<Args>(args)...));
+  }
+
+  // Big batches rebuild the whole tree from a merged sorted sequence, small
+  // ones are inserted one by one.
+  template <typename I>
+  // requires InputIterator<I>
+  void insert(I f, I l) {
+    std::vector<T> new_elements(f, l);
+    std::sort(new_elements.begin(), new_elements.end(), p_);
+    new_elements.erase(std::unique(new_elements.begin(), new_elements.end(),
+                                   helpers::not_fn(p_)),
+                       new_elements.end());
+
+    if (new_elements.size() * helpers::btree::c_rebuild_ratio < size_) {
+      for (auto& x : new_elements)
+        insert(std::move(x));
+      return;
+    }
+
+    std::vector<T> old_elements;
+    old_elements.reserve(size_);
+    move_out(root_, old_elements);
+    clear();
+
+    // On ties std::merge takes from the first range: the old elements win.
+    std::vector<T> merged;
+    merged.reserve(old_elements.size() + new_elements.size());
+    std::merge(std::make_move_iterator(old_elements.begin()),
+               std::make_move_iterator(old_elements.end()),
+               std::make_move_iterator(new_elements.begin()),
+               std::make_move_iterator(new_elements.end()),
+               std::back_inserter(merged), p_);
+    merged.erase(
+        std::unique(merged.begin(), merged.end(), helpers::not_fn(p_)),
+        merged.end());
+    build_sorted_unique(std::make_move_iterator(merged.begin()),
+                        std::make_move_iterator(merged.end()));
+  }
+
+  template <typename K>
+  size_t erase(const K& key) {
+    if (!root_)
+      return 0;
+    const size_t res = erase_from(root_, key);
+    size_ -= res;
+
+    if (root_->size == 0) {
+      node_t* old_root = root_;
+      root_ = root_->leaf ? nullptr : child(root_, 0);
+      delete_node(old_root);
+    }
+    return res;
+  }
+
+  // Calls f for each element in order.
+  template <typename F>
+  void for_each(F f) const {
+    if (root_)
+      for_each(root_, f);
+  }
+
+ private:
+  static constexpr size_t c_max_keys = helpers::btree::max_keys<T>();
+  static constexpr size_t c_min_keys = c_max_keys / 2;
+
+  using node_t = helpers::btree::node<T, c_max_keys>;
+  using inner_t = helpers::btree::inner_node<T, c_max_keys>;
+
+  static node_t*& child(node_t* x, size_t i) {
+    return static_cast<inner_t*>(x)->children[i];
+  }
+
+  static const node_t* child(const node_t* x, size_t i) {
+    return static_cast<const inner_t*>(x)->children[i];
+  }
+
+  template <typename K>
+  size_t lower_bound_in(const node_t* x, const K& key) const {
+    return helpers::btree::lower_bound_in_node(x->keys, x->size, key, p_);
+  }
+
+  static void delete_node(node_t* x) {
+    if (x->leaf)
+      delete x;
+    else
+      delete static_cast<inner_t*>(x);
+  }
+
+  static void destroy(node_t* x) {
+    if (!x)
+      return;
+    if (!x->leaf)
+      for (size_t i = 0; i <= x->size; ++i)
+        destroy(child(x, i));
+    delete_node(x);
+  }
+
+  static node_t* clone(const node_t* x) {
+    node_t* res = x->leaf ? new node_t(true) : new inner_t;
+    std::copy(x->keys, x->keys + x->size, res->keys);
+    res->size = x->size;
+    if (!x->leaf)
+      for (size_t i = 0; i <= x->size; ++i)
+        child(res, i) = clone(child(x, i));
+    return res;
+  }
+
+  template <typename F>
+  static void for_each(const node_t* x, F& f) {
+    for (size_t i = 0; i < x->size; ++i) {
+      if (!x->leaf)
+        for_each(child(x, i), f);
+      f(static_cast<const T&>(x->keys[i]));
+    }
+    if (!x->leaf)
+      for_each(child(x, x->size), f);
+  }
+
+  static void move_out(node_t* x, std::vector<T>& out) {
+    if (!x)
+      return;
+    for (size_t i = 0; i < x->size; ++i) {
+      if (!x->leaf)
+        move_out(child(x, i), out);
+      out.push_back(std::move(x->keys[i]));
+    }
+    if (!x->leaf)
+      move_out(child(x, x->size), out);
+  }
+
+  static void insert_at(node_t* x, size_t i, T value) {
+    std::move_backward(x->keys + i, x->keys + x->size,
+                       x->keys + x->size + 1);
+    x->keys[i] = std::move(value);
+    ++x->size;
+  }
+
+  // Slots past size keep moved from values, the erased one is reset so that
+  // it doesn't hold on to resources.
+  static void erase_at(node_t* x, size_t i) {
+    std::move(x->keys + i + 1, x->keys + x->size, x->keys + i);
+    x->keys[--x->size] = T();
+  }
+
+  static void insert_child_at(node_t* x, size_t i, node_t* c) {
+    auto* children = static_cast<inner_t*>(x)->children;
+    std::move_backward(children + i, children + x->size + 1,
+                       children + x->size + 2);
+    children[i] = c;
+  }
+
+  static void erase_child_at(node_t* x, size_t i) {
+    auto* children = static_cast<inner_t*>(x)->children;
+    std::move(children + i + 1, children + x->size + 1, children + i);
+  }
+
+  // Splits the full child i around its median, which moves up into x.
+  static void split_child(node_t* x, size_t i) {
+    node_t* left = child(x, i);
+    node_t* right = left->leaf ? new node_t(true) : new inner_t;
+
+    std::move(left->keys + c_min_keys + 1, left->keys + c_max_keys,
+              right->keys);
+    right->size = c_max_keys - c_min_keys - 1;
+    if (!left->leaf) {
+      std::copy(static_cast<inner_t*>(left)->children + c_min_keys + 1,
+                static_cast<inner_t*>(left)->children + c_max_keys + 1,
+                static_cast<inner_t*>(right)->children);
+    }
+
+    insert_child_at(x, i + 1, right);
+    insert_at(x, i, std::move(left->keys[c_min_keys]));
+    left->size = c_min_keys;
+  }
+
+  // Moves a key from child i through x into child i + 1.
+  static void rotate_right(node_t* x, size_t i) {
+    node_t* left = child(x, i);
+    node_t* right = child(x, i + 1);
+
+    if (!right->leaf) {
+      insert_child_at(right, 0, child(left, left->size));
+    }
+    insert_at(right, 0, std::move(x->keys[i]));
+    x->keys[i] = std::move(left->keys[left->size - 1]);
+    --left->size;
+  }
+
+  // Moves a key from child i + 1 through x into child i.
+  static void rotate_left(node_t* x, size_t i) {
+    node_t* left = child(x, i);
+    node_t* right = child(x, i + 1);
+
+    left->keys[left->size] = std::move(x->keys[i]);
+    ++left->size;
+    if (!left->leaf) {
+      child(left, left->size) = child(right, 0);
+      erase_child_at(right, 0);
+    }
+    x->keys[i] = std::move(right->keys[0]);
+    erase_at(right, 0);
+  }
+
+  // Merges child i + 1 and the key between them into child i.
+  static void merge(node_t* x, size_t i) {
+    node_t* left = child(x, i);
+    node_t* right = child(x, i + 1);
+
+    left->keys[left->size] = std::move(x->keys[i]);
+    std::move(right->keys, right->keys + right->size,
+              left->keys + left->size + 1);
+    if (!left->leaf) {
+      std::copy(static_cast<inner_t*>(right)->children,
+                static_cast<inner_t*>(right)->children + right->size + 1,
+                static_cast<inner_t*>(left)->children + left->size + 1);
+    }
+    left->size += right->size + 1;
+
+    erase_child_at(x, i + 1);
+    erase_at(x, i);
+    delete_node(right);
+  }
+
+  // Makes sure child i has more than the minimum number of keys, so that one
+  // can be removed from it. Returns the index of the child that now covers
+  // the same range.
+  static size_t refill_child(node_t* x, size_t i) {
+    if (child(x, i)->size > c_min_keys)
+      return i;
+    if (i > 0 && child(x, i - 1)->size > c_min_keys) {
+      rotate_right(x, i - 1);
+      return i;
+    }
+    if (i < x->size && child(x, i + 1)->size > c_min_keys) {
+      rotate_left(x, i);
+      return i;
+    }
+    // Inner nodes have at least one key, so there is a neighbour to merge
+    // with.
+    if (i == x->size)
+      --i;
+    merge(x, i);
+    return i;
+  }
+
+  static T take_max(node_t* x) {
+    while (!x->leaf)
+      x = child(x, refill_child(x, x->size));
+    T res = std::move(x->keys[x->size - 1]);
+    erase_at(x, x->size - 1);
+    return res;
+  }
+
+  static T take_min(node_t* x) {
+    while (!x->leaf)
+      x = child(x, refill_child(x, 0));
+    T res = std::move(x->keys[0]);
+    erase_at(x, 0);
+    return res;
+  }
+
+  template <typename K>
+  size_t erase_from(node_t* x, const K& key) {
+    while (true) {
+      size_t i = lower_bound_in(x, key);
+      const bool found = i < x->size && !p_(key, x->keys[i]);
+
+      if (x->leaf) {
+        if (!found)
+          return 0;
+        erase_at(x, i);
+        return 1;
+      }
+
+      if (found) {
+        if (child(x, i)->size > c_min_keys) {
+          x->keys[i] = take_max(child(x, i));
+          return 1;
+        }
+        if (child(x, i + 1)->size > c_min_keys) {
+          x->keys[i] = take_min(child(x, i + 1));
+          return 1;
+        }
+        // The key goes down into the merged child.
+        merge(x, i);
+        x = child(x, i);
+        continue;
+      }
+
+      x = child(x, refill_child(x, i));
+    }
+  }
+
+  // Appends along the right edge: when the last leaf is full the next element
+  // goes into the lowest non full node on the right edge, and new empty nodes
+  // start below it. Only the right edge can end up under filled, it's fixed
+  // by borrowing from the full left neighbours.
+  template <typename I>
+  void build_sorted_unique(I f, I l) {
+    if (f == l)
+      return;
+    root_ = new node_t(true);
+    std::vector<node_t*> right_edge = {root_};  // From the leaf up.
+
+    for (; f != l; ++f) {
+      size_t level = 0;
+      while (level < right_edge.size() &&
+             right_edge[level]->size == c_max_keys)
+        ++level;
+      if (level == right_edge.size()) {
+        auto* new_root = new inner_t;
+        new_root->children[0] = root_;
+        root_ = new_root;
+        right_edge.push_back(root_);
+      }
+
+      node_t* x = right_edge[level];
+      x->keys[x->size] = *f;
+      ++x->size;
+      while (level > 0) {
+        --level;
+        node_t* y = level == 0 ? new node_t(true) : new inner_t;
+        child(x, x->size) = y;
+        right_edge[level] = y;
+        x = y;
+      }
+      ++size_;
+    }
+
+    for (node_t* x = root_; !x->leaf; x = child(x, x->size)) {
+      while (child(x, x->size)->size < c_min_keys)
+        rotate_right(x, x->size - 1);
+    }
+  }
+
+  P p_;
+  node_t* root_ = nullptr;
+  size_t size_ = 0;
+};
+
+template <typename T, typename P>
+constexpr size_t btree_set<T, P>::c_max_keys;
+
+template <typename T, typename P>
+constexpr size_t btree_set<T, P>::c_min_keys;
+
+}  // namespace containers
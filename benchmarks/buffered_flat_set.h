@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/insert_algorithms.h"
+
+namespace helpers {
+
+constexpr size_t c_min_insert_buffer = 16;
+
+constexpr size_t c_lsm_first_level_capacity = 64;
+constexpr size_t c_lsm_level_ratio = 8;
+
+template <typename T, typename P>
+// requires StrictWeakOrdering<P, T>
+bool sorted_contains(const std::vector<T>& c, const T& x, P p) {
+  auto where = std::lower_bound(c.begin(), c.end(), x, p);
+  return where != c.end() && !p(x, *where);
+}
+
+// Inserts into a sorted vector, returns false if x is already there.
+template <typename T, typename P>
+// requires StrictWeakOrdering<P, T>
+bool sorted_insert(std::vector<T>& c, T x, P p) {
+  auto where = std::lower_bound(c.begin(), c.end(), x, p);
+  if (where != c.end() && !p(x, *where))
+    return false;
+  c.insert(where, std::move(x));
+  return true;
+}
+
+// Moves all elements from `from` into `to`, both sorted and unique.
+template <typename T, typename P>
+// requires StrictWeakOrdering<P, T>
+void merge_into(std::vector<T>& to, std::vector<T>& from, P p) {
+  bulk_insert::use_end_buffer_precise(to, std::make_move_iterator(from.begin()),
+                                      std::make_move_iterator(from.end()), p);
+  from.clear();
+}
+
+}  // namespace helpers
+
+namespace containers {
+
+// Sorted vector with a small sorted insertion buffer. Single inserts go into
+// the buffer, once it has about sqrt(size) elements it's merged into the
+// main vector with bulk_insert::use_end_buffer_precise. That makes inserts
+// O(sqrt(n)) amortized instead of O(n), lookups search both.
+template <typename T, typename P = std::less<>>
+// requires StrictWeakOrdering<P, T>
+class buffered_flat_set {
+ public:
+  buffered_flat_set() = default;
+  explicit buffered_flat_set(P p) : p_(p) {}
+
+  // [f, l) has to be sorted and unique.
+  template <typename I>
+  // requires ForwardIterator<I>
+  buffered_flat_set(I f, I l, P p = P{}) : p_(p), main_(f, l) {
+    update_buffer_capacity();
+  }
+
+  size_t size() const { return main_.size() + buffer_.size(); }
+  bool empty() const { return size() == 0; }
+
+  bool contains(const T& x) const {
+    return helpers::sorted_contains(main_, x, p_) ||
+           helpers::sorted_contains(buffer_, x, p_);
+  }
+
+  // Returns false if x was already there.
+  bool insert(T x) {
+    if (helpers::sorted_contains(main_, x, p_) ||
+        !helpers::sorted_insert(buffer_, std::move(x), p_))
+      return false;
+    if (buffer_.size() >= buffer_capacity_)
+      flush();
+    return true;
+  }
+
+  template <typename I>
+  // requires ForwardIterator<I>
+  void insert(I f, I l) {
+    flush();
+    bulk_insert::use_end_buffer_precise(main_, f, l, p_);
+    update_buffer_capacity();
+  }
+
+  void flush() {
+    helpers::merge_into(main_, buffer_, p_);
+    update_buffer_capacity();
+  }
+
+  // All elements in order.
+  const std::vector<T>& flat() {
+    flush();
+    return main_;
+  }
+
+ private:
+  void update_buffer_capacity() {
+    buffer_capacity_ = std::max(
+        helpers::c_min_insert_buffer,
+        static_cast<size_t>(std::sqrt(static_cast<double>(main_.size()))));
+  }
+
+  P p_;
+  std::vector<T> main_;
+  std::vector<T> buffer_;
+  size_t buffer_capacity_ = helpers::c_min_insert_buffer;
+};
+
+// Log structured flat set: a cascade of sorted runs, each c_lsm_level_ratio
+// times bigger than the previous one. Inserts go into the first level, a full
+// level is merged into the next. Every element is moved O(log n) times,
+// lookups binary search every level.
+template <typename T, typename P = std::less<>>
+// requires StrictWeakOrdering<P, T>
+class lsm_flat_set {
+ public:
+  lsm_flat_set() = default;
+  explicit lsm_flat_set(P p) : p_(p) {}
+
+  // [f, l) has to be sorted and unique.
+  template <typename I>
+  // requires ForwardIterator<I>
+  lsm_flat_set(I f, I l, P p = P{}) : p_(p) {
+    std::vector<T> elements(f, l);
+    size_ = elements.size();
+    levels_.emplace_back();
+    while (level_capacity(levels_.size() - 1) <= size_)
+      levels_.emplace_back();
+    levels_.back() = std::move(elements);
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  bool contains(const T& x) const {
+    return std::any_of(levels_.begin(), levels_.end(),
+                       [&](const std::vector<T>& level) {
+                         return helpers::sorted_contains(level, x, p_);
+                       });
+  }
+
+  // Returns false if x was already there.
+  bool insert(T x) {
+    if (contains(x))
+      return false;
+    if (levels_.empty())
+      levels_.emplace_back();
+    helpers::sorted_insert(levels_[0], std::move(x), p_);
+    ++size_;
+    cascade();
+    return true;
+  }
+
+  template <typename I>
+  // requires ForwardIterator<I>
+  void insert(I f, I l) {
+    std::vector<T> new_elements(f, l);
+    std::sort(new_elements.begin(), new_elements.end(), p_);
+    new_elements.erase(
+        std::unique(new_elements.begin(), new_elements.end(),
+                    helpers::not_fn(p_)),
+        new_elements.end());
+    new_elements.erase(
+        std::remove_if(new_elements.begin(), new_elements.end(),
+                       [&](const T& x) { return contains(x); }),
+        new_elements.end());
+
+    if (levels_.empty())
+      levels_.emplace_back();
+    size_ += new_elements.size();
+    helpers::merge_into(levels_[0], new_elements, p_);
+    cascade();
+  }
+
+  // All elements in order, after merging every level into one.
+  const std::vector<T>& flat() {
+    if (levels_.empty())
+      levels_.emplace_back();
+    for (size_t i = 0; i + 1 < levels_.size(); ++i)
+      helpers::merge_into(levels_[i + 1], levels_[i], p_);
+    levels_.front().swap(levels_.back());
+    levels_.resize(1);
+    return levels_.front();
+  }
+
+ private:
+  static size_t level_capacity(size_t i) {
+    size_t res = helpers::c_lsm_first_level_capacity;
+    while (i--)
+      res *= helpers::c_lsm_level_ratio;
+    return res;
+  }
+
+  void cascade() {
+    for (size_t i = 0; levels_[i].size() >= level_capacity(i); ++i) {
+      if (i + 1 == levels_.size())
+        levels_.emplace_back();
+      helpers::merge_into(levels_[i + 1], levels_[i], p_);
+    }
+  }
+
+  P p_;
+  std::vector<std::vector<T>> levels_;
+  size_t size_ = 0;
+};
+
+}  // namespace containers
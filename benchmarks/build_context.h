@@ -0,0 +1,56 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace helpers {
+
+inline std::string compiler_version() {
+#if defined(__clang__)
+  return std::string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+  return std::string("gcc ") + __VERSION__;
+#elif defined(_MSC_VER)
+  return "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+  return "unknown";
+#endif
+}
+
+// The build passes its flags in BENCHMARKS_CXX_FLAGS, a binary built some
+// other way only knows whether asserts are on.
+inline std::string compile_flags() {
+#ifdef BENCHMARKS_CXX_FLAGS
+  return BENCHMARKS_CXX_FLAGS;
+#elif defined(NDEBUG)
+  return "unknown, NDEBUG";
+#else
+  return "unknown";
+#endif
+}
+
+// "model name" from /proc/cpuinfo.
+inline std::string cpu_model() {
+  std::ifstream in("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, 10, "model name") != 0)
+      continue;
+    const auto colon = line.find(':');
+    if (colon != std::string::npos && colon + 2 <= line.size())
+      return line.substr(colon + 2);
+  }
+  return "unknown";
+}
+
+// What the numbers depend on besides the code, for the run level context of
+// the benchmark output.
+inline std::vector<std::pair<std::string, std::string>> build_context() {
+  return {{"compiler", compiler_version()},
+          {"compile_flags", compile_flags()},
+          {"cpu_model", cpu_model()}};
+}
+
+}  // namespace helpers
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace helpers {
+
+template <typename K>
+constexpr bool is_trivially_comparable_v =
+    std::is_arithmetic<K>::value || std::is_pointer<K>::value ||
+    std::is_enum<K>::value;
+
+// Both sides are always evaluated, so the compiler can emit flag arithmetic
+// instead of a chain of jumps.
+template <typename K, typename Rest>
+std::enable_if_t<is_trivially_comparable_v<K>, bool>
+lexicographic_step(const K& x, const K& y, Rest rest) {
+  return (x < y) | ((x == y) & rest());
+}
+
+template <typename K, typename Rest>
+std::enable_if_t<!is_trivially_comparable_v<K>, bool>
+lexicographic_step(const K& x, const K& y, Rest rest) {
+  if (x < y)
+    return true;
+  if (y < x)
+    return false;
+  return rest();
+}
+
+template <typename... Proj>
+struct lexicographic_compare;
+
+template <typename Proj>
+struct lexicographic_compare<Proj> {
+  template <typename T, typename U>
+  static bool less(const T& x, const U& y) {
+    return Proj{}(x) < Proj{}(y);
+  }
+};
+
+template <typename Proj, typename... Rest>
+struct lexicographic_compare<Proj, Rest...> {
+  template <typename T, typename U>
+  static bool less(const T& x, const U& y) {
+    return lexicographic_step(Proj{}(x), Proj{}(y), [&] {
+      return lexicographic_compare<Rest...>::less(x, y);
+    });
+  }
+};
+
+constexpr unsigned cpp14_fold_plus() {
+  return 0;
+}
+
+template <typename... Unsigned>
+constexpr unsigned cpp14_fold_plus(unsigned n, Unsigned... ns) {
+  return n + cpp14_fold_plus(ns...);
+}
+
+}  // namespace helpers
+
+namespace comparators {
+
+// Projection to std::get<I>.
+template <size_t I>
+struct element {
+  template <typename T>
+  constexpr decltype(auto) operator()(const T& x) const {
+    using std::get;
+    return get<I>(x);
+  }
+};
+
+// Compares proj(x) for each projection in order, like std::tie(...) < ...
+// but without branches for arithmetic, pointer and enum fields.
+// Projections must be default constructible.
+template <typename... Proj>
+struct lexicographic_less {
+  static_assert(sizeof...(Proj) > 0, "");
+
+  template <typename T, typename U>
+  bool operator()(const T& x, const U& y) const {
+    return helpers::lexicographic_compare<Proj...>::less(x, y);
+  }
+};
+
+// Describes a field that always fits in [Min, Min + 2^Bits).
+template <typename Proj, unsigned Bits, std::int64_t Min = 0>
+struct packed_field {
+  static_assert(Bits > 0 && Bits <= 64, "");
+
+  static constexpr unsigned bits = Bits;
+
+  template <typename T>
+  static std::uint64_t offset(const T& x) {
+    const auto v = Proj{}(x);
+    static_assert(std::is_integral<std::decay_t<decltype(v)>>::value,
+                  "packed fields have to be integers");
+    const auto res = static_cast<std::uint64_t>(v) -
+                     static_cast<std::uint64_t>(Min);
+    assert(Bits == 64 || (res >> (Bits % 64)) == 0);
+    return res;
+  }
+};
+
+// Packs all fields into one uint64_t (or unsigned __int128, if they don't
+// fit) and compares that. Gives the same order as lexicographic_less over
+// the same projections, as long as the values are in the declared ranges.
+template <typename... Fields>
+struct packed_lexicographic_less {
+  static constexpr unsigned total_bits =
+      helpers::cpp14_fold_plus(Fields::bits...);
+  static_assert(total_bits <= 128, "fields don't fit into 128 bits");
+
+  using key_type = std::conditional_t<total_bits <= 64,
+                                      std::uint64_t,
+                                      unsigned __int128>;
+
+  template <typename T>
+  static key_type pack(const T& x) {
+    key_type res = 0;
+    // Shifting in two steps, a single 64 bit field would be a full width
+    // shift.
+    (void)std::initializer_list<int>{
+        (res = ((res << (Fields::bits - 1)) << 1) | Fields::offset(x),
+         0)...};
+    return res;
+  }
+
+  template <typename T, typename U>
+  bool operator()(const T& x, const U& y) const {
+    return pack(x) < pack(y);
+  }
+};
+
+}  // namespace comparators
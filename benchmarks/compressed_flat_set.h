@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "benchmarks/bit_operations.h"
+#include "benchmarks/insert_algorithms.h"
+
+namespace helpers {
+namespace packed {
+
+constexpr size_t c_block_size = 128;
+constexpr size_t c_lanes = 4;
+
+inline unsigned bits_needed(std::uint32_t x) {
+  return x == 0 ? 0u : 32u - static_cast<unsigned>(number_of_leading_zeros(x));
+}
+
+// A block of c_block_size values, each `bits` wide, takes this many words.
+inline size_t packed_words(unsigned bits) {
+  return c_lanes * bits;
+}
+
+// Vertical layout: value i goes to lane i % c_lanes at bit (i / c_lanes) *
+// bits of that lane, word w of a lane is out[w * c_lanes + lane]. This way
+// one SIMD shift and mask unpacks c_lanes consecutive values.
+inline void pack(const std::uint32_t* in, unsigned bits, std::uint32_t* out) {
+  std::fill(out, out + packed_words(bits), 0u);
+  if (bits == 0)
+    return;
+  for (size_t i = 0; i < c_block_size; ++i) {
+    const size_t lane = i % c_lanes;
+    const size_t bit = (i / c_lanes) * bits;
+    const size_t w = bit / 32;
+    const size_t s = bit % 32;
+    out[w * c_lanes + lane] |= in[i] << s;
+    if (s + bits > 32)
+      out[(w + 1) * c_lanes + lane] |= in[i] >> (32 - s);
+  }
+}
+
+// Writes c_block_size values, each one plus base. Bits is a template
+// parameter so that the loop unrolls into shifts by constants.
+template <unsigned Bits>
+void unpack_fixed(const std::uint32_t* in,
+                  std::uint32_t base,
+                  std::uint32_t* out) {
+  if (Bits == 0) {
+    std::fill(out, out + c_block_size, base);
+    return;
+  }
+  const std::uint32_t mask = Bits == 32 ? ~0u : (1u << (Bits % 32)) - 1;
+
+#ifdef __SSE2__
+  auto load = [](const std::uint32_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  };
+  const __m128i vmask = _mm_set1_epi32(static_cast<int>(mask));
+  const __m128i vbase = _mm_set1_epi32(static_cast<int>(base));
+  for (size_t j = 0; j < c_block_size / c_lanes; ++j) {
+    const size_t bit = j * Bits;
+    const size_t w = bit / 32;
+    const int s = static_cast<int>(bit % 32);
+    __m128i v = _mm_srli_epi32(load(in + w * c_lanes), s);
+    if (s + Bits > 32)
+      v = _mm_or_si128(v, _mm_slli_epi32(load(in + (w + 1) * c_lanes), 32 - s));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + j * c_lanes),
+                     _mm_add_epi32(_mm_and_si128(v, vmask), vbase));
+  }
+#else
+  for (size_t j = 0; j < c_block_size / c_lanes; ++j) {
+    const size_t bit = j * Bits;
+    const size_t w = bit / 32;
+    const size_t s = bit % 32;
+    for (size_t lane = 0; lane < c_lanes; ++lane) {
+      std::uint32_t v = in[w * c_lanes + lane] >> s;
+      if (s + Bits > 32)
+        v |= in[(w + 1) * c_lanes + lane] << ((32 - s) % 32);
+      out[j * c_lanes + lane] = (v & mask) + base;
+    }
+  }
+#endif
+}
+
+using unpack_fn = void (*)(const std::uint32_t*, std::uint32_t, std::uint32_t*);
+
+template <size_t... Bits>
+constexpr std::array<unpack_fn, sizeof...(Bits)> make_unpack_table(
+    std::index_sequence<Bits...>) {
+  return {{&unpack_fixed<Bits>...}};
+}
+
+inline void unpack(const std::uint32_t* in,
+                   unsigned bits,
+                   std::uint32_t base,
+                   std::uint32_t* out) {
+  static constexpr auto table =
+      make_unpack_table(std::make_index_sequence<33>{});
+  table[bits](in, base, out);
+}
+
+}  // namespace packed
+}  // namespace helpers
+
+namespace containers {
+
+// Read mostly sorted set of 32 bit integers in blocks of up to 128 keys. A
+// block stores its keys as bit packed offsets from its minimum (frame of
+// reference), the minima are kept apart as a skip index. A lookup binary
+// searches the minima and unpacks one block. A bulk insert reencodes only
+// the blocks that get new keys, the other ones are copied still packed.
+template <typename T>
+class compressed_flat_set {
+  static_assert(std::is_integral<T>::value && sizeof(T) == 4,
+                "only 32 bit keys are supported");
+
+ public:
+  using value_type = T;
+
+  compressed_flat_set() = default;
+
+  // [f, l) has to be sorted and unique.
+  template <typename I>
+  // requires ForwardIterator<I>
+  compressed_flat_set(I f, I l) {
+    const std::vector<T> keys(f, l);
+    append_blocks(keys.data(), keys.data() + keys.size());
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t block_count() const { return blocks_.size(); }
+
+  // Packed data plus the skip index, not counting allocator slack.
+  size_t memory_bytes() const {
+    return words_.size() * sizeof(std::uint32_t) + minima_.size() * sizeof(T) +
+           blocks_.size() * sizeof(block_info);
+  }
+
+  bool contains(T x) const {
+    auto it = std::upper_bound(minima_.begin(), minima_.end(), x);
+    if (it == minima_.begin())
+      return false;
+    const auto i = static_cast<size_t>(it - minima_.begin()) - 1;
+
+    // Compare offsets, so the block is unpacked without adding the minimum.
+    std::uint32_t offsets[helpers::packed::c_block_size];
+    helpers::packed::unpack(words_.data() + blocks_[i].offset,
+                            blocks_[i].bits, 0, offsets);
+    return std::binary_search(offsets, offsets + blocks_[i].size,
+                              to_offset(x, minima_[i]));
+  }
+
+  template <typename I>
+  // requires ForwardIterator<I>
+  void insert(I f, I l) {
+    std::vector<T> batch(f, l);
+    std::sort(batch.begin(), batch.end());
+    batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+    if (batch.empty())
+      return;
+
+    compressed_flat_set res;
+    res.words_.reserve(words_.size());
+    std::vector<T> block_keys;
+    std::vector<T> merged;
+
+    // Block i takes the new keys below the next minimum, the first block
+    // also takes everything below its own minimum.
+    auto batch_f = batch.begin();
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+      auto batch_l = i + 1 == blocks_.size()
+                         ? batch.end()
+                         : helpers::lower_bound_biased(batch_f, batch.end(),
+                                                       minima_[i + 1],
+                                                       std::less<>{});
+      if (batch_f == batch_l) {
+        res.copy_block(*this, i);
+        continue;
+      }
+
+      decode(i, block_keys);
+      merged.clear();
+      std::set_union(block_keys.begin(), block_keys.end(), batch_f, batch_l,
+                     std::back_inserter(merged));
+      res.append_blocks(merged.data(), merged.data() + merged.size());
+      batch_f = batch_l;
+    }
+    if (blocks_.empty())
+      res.append_blocks(batch.data(), batch.data() + batch.size());
+
+    *this = std::move(res);
+  }
+
+  template <typename F>
+  // requires UnaryFunction<F, T>
+  void for_each(F f) const {
+    std::vector<T> block_keys;
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+      decode(i, block_keys);
+      std::for_each(block_keys.begin(), block_keys.end(), f);
+    }
+  }
+
+ private:
+  struct block_info {
+    std::uint32_t offset;  // in words_
+    std::uint8_t bits;
+    std::uint8_t size;
+  };
+
+  static std::uint32_t to_offset(T x, T min) {
+    return static_cast<std::uint32_t>(x) - static_cast<std::uint32_t>(min);
+  }
+
+  void decode(size_t i, std::vector<T>& out) const {
+    std::uint32_t values[helpers::packed::c_block_size];
+    helpers::packed::unpack(words_.data() + blocks_[i].offset,
+                            blocks_[i].bits,
+                            static_cast<std::uint32_t>(minima_[i]), values);
+    out.resize(blocks_[i].size);
+    std::transform(values, values + blocks_[i].size, out.begin(),
+                   [](std::uint32_t x) { return static_cast<T>(x); });
+  }
+
+  void copy_block(const compressed_flat_set& from, size_t i) {
+    const auto& info = from.blocks_[i];
+    const auto words = from.words_.begin() + info.offset;
+    minima_.push_back(from.minima_[i]);
+    blocks_.push_back(
+        {static_cast<std::uint32_t>(words_.size()), info.bits, info.size});
+    words_.insert(words_.end(), words,
+                  words + static_cast<std::ptrdiff_t>(
+                              helpers::packed::packed_words(info.bits)));
+    size_ += info.size;
+  }
+
+  // Splits sorted and unique [f, l) into blocks of about equal size.
+  void append_blocks(const T* f, const T* l) {
+    const auto n = static_cast<size_t>(l - f);
+    const size_t blocks = (n + helpers::packed::c_block_size - 1) /
+                          helpers::packed::c_block_size;
+    for (size_t i = 0; i < blocks; ++i)
+      append_block(f + n * i / blocks, f + n * (i + 1) / blocks);
+  }
+
+  void append_block(const T* f, const T* l) {
+    std::uint32_t offsets[helpers::packed::c_block_size] = {};
+    std::transform(f, l, offsets, [&](T x) { return to_offset(x, *f); });
+    const auto size = static_cast<size_t>(l - f);
+    const unsigned bits = helpers::packed::bits_needed(offsets[size - 1]);
+
+    minima_.push_back(*f);
+    blocks_.push_back({static_cast<std::uint32_t>(words_.size()),
+                       static_cast<std::uint8_t>(bits),
+                       static_cast<std::uint8_t>(size)});
+    words_.resize(words_.size() + helpers::packed::packed_words(bits));
+    helpers::packed::pack(offsets, bits,
+                          words_.data() + blocks_.back().offset);
+    size_ += size;
+  }
+
+  std::vector<std::uint32_t> words_;
+  std::vector<T> minima_;
+  std::vector<block_info> blocks_;
+  size_t size_ = 0;
+};
+
+}  // namespace containers
@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include "benchmarks/insert_algorithms.h"
+#include "benchmarks/rcu_flat_set.h"
+#include "benchmarks/sharded_flat_set.h"
+
+#include "benchmark/benchmark.h"
+
+namespace {
+
+constexpr size_t kSetSize = 100000;
+constexpr size_t kLookups = 1000;
+constexpr size_t kWriteBatch = 100;
+// The writer goes back to the initial set every kResetEvery batches, so the
+// size stays around kSetSize.
+constexpr size_t kResetEvery = 50;
+constexpr size_t kMaxReaders = 64;
+constexpr size_t kMaxWriters = 64;
+constexpr size_t kShards = 16;
+
+// Even numbers, so about half of the lookups and writes hit.
+const std::vector<int>& initial_set() {
+  static const std::vector<int> res = [] {
+    std::vector<int> v(kSetSize);
+    for (size_t i = 0; i < kSetSize; ++i)
+      v[i] = static_cast<int>(i * 2);
+    return v;
+  }();
+  return res;
+}
+
+std::uniform_int_distribution<int> key_distribution() {
+  return std::uniform_int_distribution<int>(0, static_cast<int>(kSetSize * 2));
+}
+
+std::vector<int> random_keys(size_t n, std::uint32_t seed) {
+  std::mt19937 g(seed);
+  auto dis = key_distribution();
+  std::vector<int> res(n);
+  std::generate(res.begin(), res.end(), [&] { return dis(g); });
+  return res;
+}
+
+// Baseline: readers share a lock, the writer merges in place under it.
+class locked_flat_set {
+ public:
+  class reader {
+   public:
+    explicit reader(locked_flat_set* set) : set_(set) {}
+
+    bool contains(int x) {
+      std::shared_lock<std::shared_timed_mutex> lock(set_->mutex_);
+      return std::binary_search(set_->body_.begin(), set_->body_.end(), x);
+    }
+
+   private:
+    locked_flat_set* set_;
+  };
+
+  reader make_reader() { return reader(this); }
+
+  template <typename I>
+  void insert(I f, I l) {
+    std::lock_guard<std::shared_timed_mutex> lock(mutex_);
+    bulk_insert::use_end_buffer_precise(body_, f, l, std::less<>{});
+  }
+
+  void assign(std::vector<int> v) {
+    std::lock_guard<std::shared_timed_mutex> lock(mutex_);
+    body_ = std::move(v);
+  }
+
+ private:
+  std::shared_timed_mutex mutex_;
+  std::vector<int> body_;
+};
+
+// Global std::set behind one lock.
+class locked_std_set {
+ public:
+  template <typename I>
+  void insert(I f, I l) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    body_.insert(f, l);
+  }
+
+  // Built and destroyed outside of the lock, only the swap blocks writers.
+  void assign(const std::vector<int>& v) {
+    std::set<int> body(v.begin(), v.end());
+    std::lock_guard<std::mutex> lock(mutex_);
+    body_.swap(body);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::set<int> body_;
+};
+
+using rcu_set = concurrency::rcu_flat_set<int>;
+using sharded_set = concurrency::sharded_flat_set<int>;
+
+template <typename C>
+C& shared_set();
+
+template <>
+rcu_set& shared_set<rcu_set>() {
+  static rcu_set c(kMaxReaders);
+  return c;
+}
+
+template <>
+locked_flat_set& shared_set<locked_flat_set>() {
+  static locked_flat_set c;
+  return c;
+}
+
+template <>
+sharded_set& shared_set<sharded_set>() {
+  static sharded_set c(kShards);
+  return c;
+}
+
+template <>
+locked_std_set& shared_set<locked_std_set>() {
+  static locked_std_set c;
+  return c;
+}
+
+std::atomic<bool> stop_writer{false};
+
+// Applies batches until stop_writer is set, returns how many.
+template <typename C>
+size_t write_batches(C& c) {
+  size_t batches = 0;
+  std::uint32_t seed = 0;
+  while (!stop_writer.load(std::memory_order_relaxed)) {
+    auto batch = random_keys(kWriteBatch, ++seed);
+    c.insert(batch.begin(), batch.end());
+    if (++batches % kResetEvery == 0)
+      c.assign(initial_set());
+  }
+  return batches;
+}
+
+// Every thread does lookups, state.range(0) says whether a background writer
+// applies batches meanwhile. Items processed are lookups.
+template <typename C>
+void benchmark_readers(benchmark::State& state) {
+  const bool with_writer = state.range(0) != 0;
+  C& c = shared_set<C>();
+
+  std::thread writer;
+  size_t batches = 0;
+  if (state.thread_index() == 0) {
+    c.assign(initial_set());
+    stop_writer = false;
+    if (with_writer)
+      writer = std::thread([&] { batches = write_batches(c); });
+  }
+
+  auto reader = c.make_reader();
+  const auto keys =
+      random_keys(kLookups, static_cast<std::uint32_t>(state.thread_index()));
+
+  while (state.KeepRunning()) {
+    for (int key : keys)
+      benchmark::DoNotOptimize(reader.contains(key));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(keys.size()));
+
+  if (writer.joinable()) {
+    stop_writer = true;
+    writer.join();
+    state.counters["writer_batches"] = static_cast<double>(batches);
+  }
+}
+
+void readers_and_writer(benchmark::internal::Benchmark* bench) {
+  bench->ArgName("writer")->Arg(0)->Arg(1)->ThreadRange(1, kMaxReaders);
+  bench->UseRealTime();
+}
+
+// Batches applied by all writers since the set was reset.
+std::atomic<size_t> written_batches{0};
+
+// Runs before the threads of a benchmark_writers run start.
+template <typename C>
+void reset_writers_set(const benchmark::State&) {
+  shared_set<C>().assign(initial_set());
+  written_batches = 0;
+}
+
+// Every thread inserts fresh batches of random keys into one shared set,
+// about half of the keys are new. Every kResetEvery batches, counted over
+// all threads, the set goes back to the initial one, untimed, so it does not
+// fill up with the whole key space. Generating the keys is timed, the same
+// for every set. Items processed are inserted keys, including the ones that
+// were already there.
+template <typename C>
+void benchmark_writers(benchmark::State& state) {
+  C& c = shared_set<C>();
+
+  std::mt19937 g(static_cast<std::uint32_t>(state.thread_index()) + 1000);
+  auto dis = key_distribution();
+  std::vector<int> batch(kWriteBatch);
+  while (state.KeepRunning()) {
+    std::generate(batch.begin(), batch.end(), [&] { return dis(g); });
+    c.insert(batch.begin(), batch.end());
+    if ((written_batches.fetch_add(1) + 1) % kResetEvery == 0) {
+      state.PauseTiming();
+      c.assign(initial_set());
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(kWriteBatch));
+}
+
+template <typename C>
+void writers(benchmark::internal::Benchmark* bench) {
+  bench->ThreadRange(1, kMaxWriters)->UseRealTime();
+  bench->Setup(reset_writers_set<C>);
+}
+
+BENCHMARK_TEMPLATE(benchmark_readers, rcu_set)->Apply(readers_and_writer);
+BENCHMARK_TEMPLATE(benchmark_readers, locked_flat_set)
+    ->Apply(readers_and_writer);
+
+BENCHMARK_TEMPLATE(benchmark_writers, sharded_set)
+    ->Apply(writers<sharded_set>);
+BENCHMARK_TEMPLATE(benchmark_writers, locked_flat_set)
+    ->Apply(writers<locked_flat_set>);
+BENCHMARK_TEMPLATE(benchmark_writers, locked_std_set)
+    ->Apply(writers<locked_std_set>);
+
+}  // namespace
+
+BENCHMARK_MAIN();
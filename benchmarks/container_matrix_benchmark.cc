@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/btree.h"
+#include "benchmarks/input_ring.h"
+#include "benchmarks/insert_algorithms.h"
+#include "benchmarks/swiss_table.h"
+
+#include "benchmark/benchmark.h"
+
+// Every operation for every container and element type, so that choosing a
+// container is based on numbers for the actual use case.
+// Benchmarks are named <operation>/<container>/<element>/<size>, run a subset
+// with --benchmark_filter, e.g. "lookup/.*/string_heap".
+
+namespace {
+
+constexpr size_t kMinSize = 10;
+constexpr size_t kMaxSize = 10000000;
+// Inserting or erasing one by one in a sorted vector is quadratic.
+constexpr size_t kMaxFlatOneByOneSize = 100000;
+
+// Element types -------------------------------------------------------------
+
+struct pod64 {
+  std::array<std::uint64_t, 8> data;
+
+  friend bool operator<(const pod64& x, const pod64& y) {
+    return x.data < y.data;
+  }
+  friend bool operator==(const pod64& x, const pod64& y) {
+    return x.data == y.data;
+  }
+};
+
+struct do_nothing {
+  template <typename T>
+  void operator()(T*) {}
+};
+
+using unique_t = std::unique_ptr<int, do_nothing>;
+
+struct string_sso {};
+struct string_heap {};
+
+// Distinct ids map to distinct elements.
+std::int32_t make_value(std::uint64_t id, std::int32_t*) {
+  return static_cast<std::int32_t>(id);
+}
+
+std::int64_t make_value(std::uint64_t id, std::int64_t*) {
+  return static_cast<std::int64_t>(id * 0x9E3779B97F4A7C15ull);
+}
+
+int* make_value(std::uint64_t id, int**) {
+  return reinterpret_cast<int*>((id + 1) * sizeof(int));
+}
+
+pod64 make_value(std::uint64_t id, pod64*) {
+  pod64 res;
+  res.data.fill(id);
+  return res;
+}
+
+unique_t make_value(std::uint64_t id, unique_t*) {
+  return unique_t(make_value(id, static_cast<int**>(nullptr)));
+}
+
+// Short enough for the small string optimization.
+std::string make_value(std::uint64_t id, string_sso*) {
+  return std::to_string(id);
+}
+
+std::string make_value(std::uint64_t id, string_heap*) {
+  return "a string that does not fit in place " + std::to_string(id);
+}
+
+template <typename Tag>
+struct element_traits {
+  using type = Tag;
+};
+
+template <>
+struct element_traits<string_sso> {
+  using type = std::string;
+};
+
+template <>
+struct element_traits<string_heap> {
+  using type = std::string;
+};
+
+template <typename Tag>
+using element_t = typename element_traits<Tag>::type;
+
+struct element_hash {
+  template <typename T>
+  size_t operator()(const T& x) const {
+    return std::hash<T>{}(x);
+  }
+
+  size_t operator()(const pod64& x) const {
+    return std::hash<std::uint64_t>{}(x.data[0]);
+  }
+};
+
+// Inputs --------------------------------------------------------------------
+
+// Inserted ids are even, looked up ids are random, so about half of the
+// lookups find something.
+struct ids {
+  std::vector<std::uint64_t> inserted;
+  std::vector<std::uint64_t> looked_up;
+};
+
+const ids& input_ids(size_t size) {
+  static std::map<size_t, ids> cached_ids;
+
+  auto found = cached_ids.find(size);
+  if (found == cached_ids.end()) {
+    std::mt19937 g;
+    ids res;
+    res.inserted.resize(size);
+    for (size_t i = 0; i < size; ++i)
+      res.inserted[i] = 2 * i;
+    std::shuffle(res.inserted.begin(), res.inserted.end(), g);
+
+    std::uniform_int_distribution<std::uint64_t> dis(0, 2 * size);
+    res.looked_up.resize(size);
+    std::generate(res.looked_up.begin(), res.looked_up.end(),
+                  [&] { return dis(g); });
+    found = cached_ids.emplace(size, std::move(res)).first;
+  }
+
+  return found->second;
+}
+
+template <typename Tag, typename I>
+std::vector<element_t<Tag>> make_values(I f, I l) {
+  std::vector<element_t<Tag>> res;
+  res.reserve(static_cast<size_t>(std::distance(f, l)));
+  for (; f != l; ++f)
+    res.push_back(make_value(*f, static_cast<Tag*>(nullptr)));
+  return res;
+}
+
+// Containers ----------------------------------------------------------------
+
+template <typename T>
+using std_set = std::set<T>;
+
+// Sorted vector, the bulk insert is bulk_insert::use_end_buffer_precise.
+template <typename T>
+using flat_set = std::vector<T>;
+
+template <typename T>
+using swiss_set = containers::swiss_set<T, element_hash>;
+
+template <typename T>
+using btree_set = containers::btree_set<T>;
+
+template <typename T>
+void insert_one(std_set<T>& c, T x) {
+  c.insert(std::move(x));
+}
+
+template <typename T>
+void insert_one(flat_set<T>& c, T x) {
+  auto where = std::lower_bound(c.begin(), c.end(), x);
+  if (where == c.end() || x < *where)
+    c.insert(where, std::move(x));
+}
+
+template <typename T>
+void insert_one(swiss_set<T>& c, T x) {
+  c.insert(std::move(x));
+}
+
+template <typename T>
+void insert_one(btree_set<T>& c, T x) {
+  c.insert(std::move(x));
+}
+
+template <typename T>
+void insert_many(std_set<T>& c, std::vector<T>& xs) {
+  c.insert(std::make_move_iterator(xs.begin()),
+           std::make_move_iterator(xs.end()));
+}
+
+template <typename T>
+void insert_many(flat_set<T>& c, std::vector<T>& xs) {
+  bulk_insert::use_end_buffer_precise(c, std::make_move_iterator(xs.begin()),
+                                      std::make_move_iterator(xs.end()),
+                                      std::less<>{});
+}
+
+template <typename T>
+void insert_many(swiss_set<T>& c, std::vector<T>& xs) {
+  c.insert(std::make_move_iterator(xs.begin()),
+           std::make_move_iterator(xs.end()));
+}
+
+template <typename T>
+void insert_many(btree_set<T>& c, std::vector<T>& xs) {
+  c.insert(std::make_move_iterator(xs.begin()),
+           std::make_move_iterator(xs.end()));
+}
+
+template <typename T>
+bool contains(const std_set<T>& c, const T& x) {
+  return c.find(x) != c.end();
+}
+
+template <typename T>
+bool contains(const flat_set<T>& c, const T& x) {
+  return std::binary_search(c.begin(), c.end(), x);
+}
+
+template <typename T>
+bool contains(const swiss_set<T>& c, const T& x) {
+  return c.contains(x);
+}
+
+template <typename T>
+bool contains(const btree_set<T>& c, const T& x) {
+  return c.contains(x);
+}
+
+template <typename T, typename F>
+void for_each(const std_set<T>& c, F f) {
+  std::for_each(c.begin(), c.end(), f);
+}
+
+template <typename T, typename F>
+void for_each(const flat_set<T>& c, F f) {
+  std::for_each(c.begin(), c.end(), f);
+}
+
+template <typename T, typename F>
+void for_each(const swiss_set<T>& c, F f) {
+  c.for_each(f);
+}
+
+template <typename T, typename F>
+void for_each(const btree_set<T>& c, F f) {
+  c.for_each(f);
+}
+
+template <typename T>
+void erase_one(std_set<T>& c, const T& x) {
+  c.erase(x);
+}
+
+template <typename T>
+void erase_one(flat_set<T>& c, const T& x) {
+  auto where = std::lower_bound(c.begin(), c.end(), x);
+  if (where != c.end() && !(x < *where))
+    c.erase(where);
+}
+
+template <typename T>
+void erase_one(swiss_set<T>& c, const T& x) {
+  c.erase(x);
+}
+
+template <typename T>
+void erase_one(btree_set<T>& c, const T& x) {
+  c.erase(x);
+}
+
+template <typename C, typename T>
+C make_container(std::vector<T> xs) {
+  C res;
+  insert_many(res, xs);
+  return res;
+}
+
+// Operations ----------------------------------------------------------------
+// state.range(0) is the number of elements. The mutating ones run on a ring
+// of inputs prepared untimed, see input_ring.h.
+
+// A container and the values that go into it.
+template <typename C, typename Tag>
+struct insert_input {
+  C c;
+  std::vector<element_t<Tag>> values;
+};
+
+template <typename Tag>
+size_t ring_size_for(benchmark::State& state) {
+  return helpers::input_ring_size(static_cast<size_t>(state.range(0)) *
+                                  sizeof(element_t<Tag>));
+}
+
+template <typename C, typename Tag>
+void benchmark_insert(benchmark::State& state) {
+  const auto& in = input_ids(static_cast<size_t>(state.range(0))).inserted;
+  std::vector<insert_input<C, Tag>> ring(ring_size_for<Tag>(state));
+  auto refill = [&](std::vector<insert_input<C, Tag>>& inputs) {
+    for (auto& input : inputs) {
+      input.c = C();
+      input.values = make_values<Tag>(in.begin(), in.end());
+    }
+  };
+  refill(ring);
+
+  helpers::run_on_ring(state, ring,
+                       [](insert_input<C, Tag>& input) {
+                         for (auto& x : input.values)
+                           insert_one(input.c, std::move(x));
+                         benchmark::DoNotOptimize(&input.c);
+                       },
+                       refill);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Inserts the second half of the elements into a container with the first.
+template <typename C, typename Tag>
+void benchmark_bulk_insert(benchmark::State& state) {
+  const auto& in = input_ids(static_cast<size_t>(state.range(0))).inserted;
+  const auto middle = in.begin() + static_cast<std::ptrdiff_t>(in.size() / 2);
+  std::vector<insert_input<C, Tag>> ring(ring_size_for<Tag>(state));
+  auto refill = [&](std::vector<insert_input<C, Tag>>& inputs) {
+    for (auto& input : inputs) {
+      input.c = make_container<C>(make_values<Tag>(in.begin(), middle));
+      input.values = make_values<Tag>(middle, in.end());
+    }
+  };
+  refill(ring);
+
+  helpers::run_on_ring(state, ring,
+                       [](insert_input<C, Tag>& input) {
+                         insert_many(input.c, input.values);
+                         benchmark::DoNotOptimize(&input.c);
+                       },
+                       refill);
+  state.SetItemsProcessed(state.iterations() * state.range(0) / 2);
+}
+
+template <typename C, typename Tag>
+void benchmark_lookup(benchmark::State& state) {
+  const auto& input = input_ids(static_cast<size_t>(state.range(0)));
+  const auto c = make_container<C>(
+      make_values<Tag>(input.inserted.begin(), input.inserted.end()));
+  const auto keys =
+      make_values<Tag>(input.looked_up.begin(), input.looked_up.end());
+
+  while (state.KeepRunning()) {
+    for (const auto& key : keys)
+      benchmark::DoNotOptimize(contains(c, key));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename C, typename Tag>
+void benchmark_iterate(benchmark::State& state) {
+  const auto& in = input_ids(static_cast<size_t>(state.range(0))).inserted;
+  const auto c = make_container<C>(make_values<Tag>(in.begin(), in.end()));
+
+  while (state.KeepRunning()) {
+    for_each(c, [](const element_t<Tag>& x) { benchmark::DoNotOptimize(&x); });
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Erases all elements one by one, in an order different from the insertion.
+template <typename C, typename Tag>
+void benchmark_erase(benchmark::State& state) {
+  const auto& in = input_ids(static_cast<size_t>(state.range(0))).inserted;
+  const auto keys = make_values<Tag>(in.rbegin(), in.rend());
+  // Element types can be move only, the containers are made, not copied.
+  std::vector<C> ring(ring_size_for<Tag>(state));
+  auto refill = [&](std::vector<C>& cs) {
+    for (auto& c : cs)
+      c = make_container<C>(make_values<Tag>(in.begin(), in.end()));
+  };
+  refill(ring);
+
+  helpers::run_on_ring(state, ring,
+                       [&](C& c) {
+                         for (const auto& key : keys)
+                           erase_one(c, key);
+                         benchmark::DoNotOptimize(&c);
+                       },
+                       refill);
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Registration --------------------------------------------------------------
+
+void set_sizes(benchmark::internal::Benchmark* bench, size_t max_size) {
+  for (size_t size = kMinSize; size <= max_size; size *= 10)
+    bench->Arg(static_cast<int64_t>(size));
+}
+
+template <template <typename> class C>
+size_t max_one_by_one_size() {
+  return kMaxSize;
+}
+
+template <>
+size_t max_one_by_one_size<flat_set>() {
+  return kMaxFlatOneByOneSize;
+}
+
+template <template <typename> class C, typename Tag>
+void register_container(const std::string& container,
+                        const std::string& element) {
+  using c_t = C<element_t<Tag>>;
+  auto add = [&](const std::string& operation, void (*f)(benchmark::State&),
+                 size_t max_size) {
+    const auto name = operation + "/" + container + "/" + element;
+    set_sizes(benchmark::RegisterBenchmark(name.c_str(), f), max_size);
+  };
+
+  add("insert", benchmark_insert<c_t, Tag>, max_one_by_one_size<C>());
+  add("bulk_insert", benchmark_bulk_insert<c_t, Tag>, kMaxSize);
+  add("lookup", benchmark_lookup<c_t, Tag>, kMaxSize);
+  add("iterate", benchmark_iterate<c_t, Tag>, kMaxSize);
+  add("erase", benchmark_erase<c_t, Tag>, max_one_by_one_size<C>());
+}
+
+template <typename Tag>
+void register_element(const std::string& element) {
+  register_container<std_set, Tag>("std_set", element);
+  register_container<flat_set, Tag>("flat_set", element);
+  register_container<swiss_set, Tag>("swiss_set", element);
+  register_container<btree_set, Tag>("btree_set", element);
+}
+
+bool register_benchmarks() {
+  register_element<std::int32_t>("int32");
+  register_element<std::int64_t>("int64");
+  register_element<int*>("pointer");
+  register_element<string_sso>("string_sso");
+  register_element<string_heap>("string_heap");
+  register_element<pod64>("pod64");
+  register_element<unique_t>("unique_ptr");
+  return true;
+}
+
+const bool registered = register_benchmarks();
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <algorithm>
 #include <cstring>
 #include <iterator>
@@ -53,15 +55,42 @@ struct copy_iterator_unwrapper : TrivialCopyAlgorithms {
 
   template <typename I, typename O>
   static O run_copy(std::move_iterator<I> f, std::move_iterator<I> l, O o) {
-    return run_copy(unwrap_move_iterator(f), unwrap_move_iterator(l), o);
+    return run_unwrapped_copy(unwrap_move_iterator(f), unwrap_move_iterator(l),
+                              o);
   }
 
   template <typename I, typename O>
   static O run_copy_backward(std::move_iterator<I> f,
                              std::move_iterator<I> l,
                              O o) {
-    return run_copy_backward(unwrap_move_iterator(f), unwrap_move_iterator(l),
-                             o);
+    return run_unwrapped_copy_backward(unwrap_move_iterator(f),
+                                       unwrap_move_iterator(l), o);
+  }
+
+  // Move iterators that could not be unwrapped (not trivial types) go
+  // straight to the underlying algorithms.
+  template <typename I, typename O>
+  static O run_unwrapped_copy(std::move_iterator<I> f,
+                              std::move_iterator<I> l,
+                              O o) {
+    return TrivialCopyAlgorithms::run_copy(f, l, o);
+  }
+
+  template <typename I, typename O>
+  static O run_unwrapped_copy(I f, I l, O o) {
+    return run_copy(f, l, o);
+  }
+
+  template <typename I, typename O>
+  static O run_unwrapped_copy_backward(std::move_iterator<I> f,
+                                       std::move_iterator<I> l,
+                                       O o) {
+    return TrivialCopyAlgorithms::run_copy_backward(f, l, o);
+  }
+
+  template <typename I, typename O>
+  static O run_unwrapped_copy_backward(I f, I l, O o) {
+    return run_copy_backward(f, l, o);
   }
 
   template <typename I, typename O>
@@ -138,9 +167,6 @@ O copy_backward(I f, I l, O o) {
 
 template <typename I, typename O>
 O strict_copy(I f, I l, O o) {
-#ifdef NDEBUG
-  static_assert(std::is_same<std::vector<int>::iterator, int*>, "");
-#endif
   return copy_iterator_unwrapper<strict_copy_impl>{}.run_copy(f, l, o);
 }
 
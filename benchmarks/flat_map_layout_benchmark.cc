@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/input_ring.h"
+#include "benchmarks/insert_algorithms.h"
+#include "benchmarks/split_flat_map.h"
+
+#include "benchmark/benchmark.h"
+
+namespace {
+
+using key_type = std::int32_t;
+using mapped_type = std::array<std::int64_t, 8>;
+using element_type = std::pair<key_type, mapped_type>;
+
+constexpr size_t kLookups = 1000;
+
+struct key_less {
+  bool operator()(const element_type& x, const element_type& y) const {
+    return x.first < y.first;
+  }
+};
+
+using split_map = containers::split_flat_map<key_type, mapped_type>;
+using pair_map = std::vector<element_type>;
+
+// Random keys, duplicates are dropped on insert.
+const std::vector<element_type>& inputs(size_t size) {
+  static std::map<size_t, std::vector<element_type>> cached_inputs;
+
+  auto found = cached_inputs.find(size);
+  if (found == cached_inputs.end()) {
+    std::mt19937 g;
+    std::uniform_int_distribution<key_type> dis(
+        0, static_cast<key_type>(size * 4));
+    std::vector<element_type> res(size);
+    for (auto& x : res) {
+      x.first = dis(g);
+      x.second.fill(x.first);
+    }
+    found = cached_inputs.emplace(size, std::move(res)).first;
+  }
+
+  return found->second;
+}
+
+const std::vector<key_type>& lookups(size_t size) {
+  static std::map<size_t, std::vector<key_type>> cached_lookups;
+
+  auto found = cached_lookups.find(size);
+  if (found == cached_lookups.end()) {
+    std::mt19937 g;
+    std::uniform_int_distribution<key_type> dis(
+        0, static_cast<key_type>(size * 4));
+    std::vector<key_type> res(kLookups);
+    std::generate(res.begin(), res.end(), [&] { return dis(g); });
+    found = cached_lookups.emplace(size, std::move(res)).first;
+  }
+
+  return found->second;
+}
+
+template <typename I>
+void insert(split_map& c, I f, I l) {
+  c.insert(f, l);
+}
+
+template <typename I>
+void insert(pair_map& c, I f, I l) {
+  bulk_insert::use_end_buffer_precise(c, f, l, key_less{});
+}
+
+const mapped_type* find(const split_map& c, key_type key) {
+  return c.find(key);
+}
+
+const mapped_type* find(const pair_map& c, key_type key) {
+  auto it = std::lower_bound(
+      c.begin(), c.end(), key,
+      [](const element_type& x, key_type k) { return x.first < k; });
+  if (it == c.end() || key < it->first)
+    return nullptr;
+  return &it->second;
+}
+
+template <typename C>
+C make_map(const std::vector<element_type>& input) {
+  C res;
+  insert(res, input.begin(), input.end());
+  return res;
+}
+
+// state.range(0) is the size of the map.
+template <typename C>
+void benchmark_lookup(benchmark::State& state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const C c = make_map<C>(inputs(size));
+  const auto& keys = lookups(size);
+
+  while (state.KeepRunning()) {
+    for (auto key : keys)
+      benchmark::DoNotOptimize(find(c, key));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(keys.size()));
+}
+
+// Inserts the second half of the input into a map built from the first half.
+template <typename C>
+void benchmark_bulk_insert(benchmark::State& state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto& input = inputs(size);
+  const auto middle = input.begin() + static_cast<std::ptrdiff_t>(size / 2);
+  const C c = make_map<C>({input.begin(), middle});
+
+  // The copies are made untimed, see input_ring.h.
+  helpers::run_on_copies(
+      state, c, helpers::input_ring_size(c.size() * sizeof(element_type)),
+      [&](C& c_copy) {
+        insert(c_copy, middle, input.end());
+        benchmark::DoNotOptimize(c_copy.size());
+      });
+}
+
+void set_sizes(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(100, 1000000);
+}
+
+BENCHMARK_TEMPLATE(benchmark_lookup, split_map)->Apply(set_sizes);
+BENCHMARK_TEMPLATE(benchmark_lookup, pair_map)->Apply(set_sizes);
+BENCHMARK_TEMPLATE(benchmark_bulk_insert, split_map)->Apply(set_sizes);
+BENCHMARK_TEMPLATE(benchmark_bulk_insert, pair_map)->Apply(set_sizes);
+
+}  // namespace
+
+BENCHMARK_MAIN();
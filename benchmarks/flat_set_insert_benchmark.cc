@@ -1,186 +1,650 @@
 #include "benchmarks/insert_algorithms.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
 #include <random>
 #include <set>
 #include <map>
 #include <string>
 #include <vector>
 
-#include "third_party/benchmark/include/benchmark/benchmark.h"
+#include "benchmarks/allocation_tracking.h"
+#include "benchmarks/btree.h"
+#include "benchmarks/build_context.h"
+#include "benchmarks/buffered_flat_set.h"
+#include "benchmarks/compressed_flat_set.h"
+#include "benchmarks/input_ring.h"
+#include "benchmarks/instrumented.h"
+#include "benchmarks/perf_counters.h"
+#include "benchmarks/roaring_set.h"
+#include "benchmarks/workload.h"
+#include "benchmark/benchmark.h"
 
 namespace {
 
-constexpr int c_set_size = 1000;
-constexpr int c_distribution_size = 1000000;
-
-constexpr int c_min_input_size = 1;
-constexpr int c_max_input_size = 1000;
-constexpr int c_input_step = 1;
-
 using int_vec = std::vector<int>;
 
-std::pair<int_vec*, int_vec*> test_input_data(int inserting_size) {
-  auto random_number = [] {
-    static std::mt19937 g;
-    static std::uniform_int_distribution<> dis(1, c_distribution_size);
-    return dis(g);
-  };
+// Set from the command line before the benchmarks are registered.
+workload::spec& workload_spec() {
+  static workload::spec res;
+  return res;
+}
 
-  static int_vec already_in = [&] {
-    assert(c_distribution_size > c_set_size);
-    std::set<int> res;
-    while (res.size() < c_set_size)
-      res.insert(random_number());
-    return int_vec(res.begin(), res.end());
-  }();
+// The int only sections below take the distribution and the seed from
+// workload_spec, with sizes of their own.
+workload::spec int_workload(size_t set_size, std::uint64_t distribution_size) {
+  auto res = workload_spec();
+  res.key = workload::key_kind::int32;
+  res.set_size = set_size;
+  res.distribution_size = distribution_size;
+  return res;
+}
 
-  static std::map<int, std::vector<int>> inserting_cache;
+template <typename T>
+std::pair<const std::vector<T>*, const std::vector<T>*> test_input_data(
+    size_t inserting_size) {
+  static const workload::generator generator(workload_spec());
+  static const std::vector<T> already_in = generator.set<T>();
+  static std::map<size_t, std::vector<T>> inserting_cache;
 
   auto found = inserting_cache.find(inserting_size);
   if (found == inserting_cache.end()) {
-    found = inserting_cache.insert({inserting_size,
-                                    [&] {
-                                      int_vec res(
-                                          static_cast<size_t>(inserting_size));
-                                      std::generate(res.begin(), res.end(),
-                                                    random_number);
-                                      return res;
-                                    }()}).first;
+    found = inserting_cache
+                .emplace(inserting_size, generator.batch<T>(inserting_size))
+                .first;
   }
 
   return {&already_in, &found->second};
 }
 
-template <typename F>
+// One more, untimed, call with instrumented keys in a counting vector.
+template <typename T, typename F>
+void report_operation_counts(benchmark::State& state,
+                             const std::vector<T>& already_in,
+                             const std::vector<T>& inserting,
+                             F insertion_algorithm) {
+  using key = helpers::instrumented<T>;
+  using key_vec = std::vector<key, helpers::counting_allocator<key>>;
+  auto wrap = [](const std::vector<T>& xs) {
+    key_vec res;
+    res.reserve(xs.size());
+    for (const auto& x : xs)
+      res.emplace_back(x);
+    return res;
+  };
+
+  auto c = wrap(already_in);
+  const auto batch = wrap(inserting);
+  helpers::operation_counter counter;
+  insertion_algorithm(c, batch.begin(), batch.end());
+  counter.report(state);
+}
+
+// The copies of the set are made untimed, in a ring (see input_ring.h), so
+// the time is the insertion alone and the baseline is close to 0.
+template <typename T, typename F>
 // requires PureFunction<F>
 void benchmark_unique_insert(benchmark::State& state, F insertion_algorithm) {
-  auto input = test_input_data(state.range(0));
-  while (state.KeepRunning()) {
-    auto c = *input.first;
-    auto f = input.second->begin();
-    auto l = input.second->end();
-    insertion_algorithm(c, f, l);
-  }
+  auto input = test_input_data<T>(static_cast<size_t>(state.range(0)));
+  const auto& already_in = *input.first;
+  std::vector<std::vector<T>> ring(
+      helpers::input_ring_size(already_in.size() * sizeof(T)), already_in);
+
+  helpers::perf_counters counters;
+  counters.start();
+  helpers::run_on_ring(
+      state, ring,
+      [&](std::vector<T>& c) {
+        insertion_algorithm(c, input.second->begin(), input.second->end());
+      },
+      [&](std::vector<std::vector<T>>& copies) {
+        counters.pause();
+        std::fill(copies.begin(), copies.end(), already_in);
+        counters.resume();
+      });
+  counters.stop();
+  counters.report(state);
+  auto one_more = already_in;
+  helpers::report_allocations_of_one(state, [&] {
+    insertion_algorithm(one_more, input.second->begin(), input.second->end());
+  });
+  report_operation_counts(state, *input.first, *input.second,
+                          insertion_algorithm);
+
+  const auto batch_size = static_cast<std::int64_t>(input.second->size());
+  state.counters["batch_size"] = static_cast<double>(batch_size);
+  state.SetItemsProcessed(state.iterations() * batch_size);
+  state.SetBytesProcessed(state.iterations() * batch_size *
+                          static_cast<std::int64_t>(sizeof(T)));
 }
 
+template <typename T>
 void baseline(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto&&...) {});
-
-  // hacking into benchmark's json output.
-  // clang-format off
-  std::string extra_data =
-      /*"label" : "*/ "\",\n"                                                              //
-"      \"extra_data\":  {\n"                                                                                                                        //
-"        \"set_size\": " + std::to_string(c_set_size) + ",\n"
-"        \"distribution_size\": " + std::to_string(c_distribution_size) + "\n"
-"        },\n"
-"      \"junk_field\": \""/*"*/;
-  // clang-format on
-  state.SetLabel(extra_data);
+  benchmark_unique_insert<T>(state, [](auto&&...) {});
 }
 
+template <typename T>
 void benchmark_one_at_a_time(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::one_at_a_time(c, f, l, std::less<>{});
   });
 }
 
+template <typename T>
 void benchmark_stable_sort_and_unique(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::stable_sort_and_unique(c, f, l, std::less<>{});
   });
 }
 
+template <typename T>
 void benchmark_full_inplace_merge(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::full_inplace_merge(c, f, l, std::less<>{});
   });
 }
 
+template <typename T>
 void benchmark_copy_unique_full_inplace_merge(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::copy_unique_full_inplace_merge(c, f, l, std::less<>{});
   });
 }
 
+template <typename T>
 void benchmark_copy_unique_inplace_merge_cache_begin(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::copy_unique_inplace_merge_cache_begin(c, f, l, std::less<>{});
   });
 }
 
+template <typename T>
 void benchmark_copy_unique_inplace_merge_upper_bound(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::copy_unique_inplace_merge_upper_bound(c, f, l, std::less<>{});
   });
 }
 
+template <typename T>
 void benchmark_copy_unique_inplace_merge_no_buffer(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::copy_unique_inplace_merge_no_buffer(c, f, l, std::less<>{});
   });
 }
 
+template <typename T>
 void benchmark_use_end_buffer_precise(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::use_end_buffer_precise(c, f, l, std::less<>{});
   });
 }
 
+template <typename T>
 void benchmark_reallocate_and_merge(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::reallocate_and_merge(c, f, l, std::less<>{});
   });
 }
 
+template <typename T>
 void benchmark_use_end_buffer_new_size(benchmark::State& state) {
-  benchmark_unique_insert(state, [](auto& c, auto f, auto l) {
+  benchmark_unique_insert<T>(state, [](auto& c, auto f, auto l) {
     bulk_insert::use_end_buffer_new_size(c, f, l, std::less<>{});
   });
 }
 
+// Same sets in a B-tree, copied untimed like the vectors above.
+template <typename T>
+void benchmark_btree_set(benchmark::State& state) {
+  auto input = test_input_data<T>(static_cast<size_t>(state.range(0)));
+  const containers::btree_set<T> already_in(
+      containers::sorted_unique, input.first->begin(), input.first->end());
+  auto insert = [&](containers::btree_set<T>& c) {
+    c.insert(input.second->begin(), input.second->end());
+  };
+
+  helpers::run_on_copies(
+      state, already_in,
+      helpers::input_ring_size(input.first->size() * sizeof(T)), insert);
+  auto one_more = already_in;
+  helpers::report_allocations_of_one(state, [&] { insert(one_more); });
+}
+
+template <typename T>
 void boost_and_eastl_solution(benchmark::State& state) {
-  benchmark_one_at_a_time(state);
+  benchmark_one_at_a_time<T>(state);
 }
 
+template <typename T>
 void folly_solution(benchmark::State& state) {
-  benchmark_full_inplace_merge(state);
+  benchmark_full_inplace_merge<T>(state);
 }
 
+template <typename T>
 void chromium_solution(benchmark::State& state) {
-  benchmark_copy_unique_inplace_merge_cache_begin(state);
+  benchmark_copy_unique_inplace_merge_cache_begin<T>(state);
 }
 
+template <typename T>
 void proposed_solution(benchmark::State& state) {
-  benchmark_use_end_buffer_precise(state);
-}
-
-void set_input_sizes(benchmark::internal::Benchmark* bench) {
-  for (int i = c_min_input_size; i < c_max_input_size; i += c_input_step)
-    bench->Arg(i);
-}
-
-BENCHMARK(baseline)->Apply(set_input_sizes);
-BENCHMARK(benchmark_one_at_a_time)->Apply(set_input_sizes);
-BENCHMARK(benchmark_stable_sort_and_unique)->Apply(set_input_sizes);
-BENCHMARK(benchmark_full_inplace_merge)->Apply(set_input_sizes);
-BENCHMARK(benchmark_copy_unique_full_inplace_merge)->Apply(set_input_sizes);
-BENCHMARK(benchmark_copy_unique_inplace_merge_cache_begin)
-    ->Apply(set_input_sizes);
-BENCHMARK(benchmark_copy_unique_inplace_merge_upper_bound)
-    ->Apply(set_input_sizes);
-BENCHMARK(benchmark_copy_unique_inplace_merge_no_buffer)
-    ->Apply(set_input_sizes);
-BENCHMARK(benchmark_use_end_buffer_precise)->Apply(set_input_sizes);
-BENCHMARK(benchmark_reallocate_and_merge)->Apply(set_input_sizes);
-BENCHMARK(benchmark_use_end_buffer_new_size)->Apply(set_input_sizes);
-
-BENCHMARK(boost_and_eastl_solution)->Apply(set_input_sizes);
-BENCHMARK(folly_solution)->Apply(set_input_sizes);
-BENCHMARK(chromium_solution)->Apply(set_input_sizes);
-BENCHMARK(proposed_solution)->Apply(set_input_sizes);
+  benchmark_use_end_buffer_precise<T>(state);
+}
+
+// Mixed single inserts and lookups --------------------------------------------
+
+constexpr size_t c_mixed_set_size = 100000;
+constexpr size_t c_mixed_operations = 10000;
+
+struct mixed_operation {
+  bool insert;
+  int value;
+};
+
+workload::spec mixed_workload() {
+  return int_workload(c_mixed_set_size, workload_spec().distribution_size);
+}
+
+const workload::generator& mixed_generator() {
+  static const workload::generator res(mixed_workload());
+  return res;
+}
+
+const int_vec& mixed_already_in() {
+  static const int_vec cached_res = mixed_generator().set<int>();
+  return cached_res;
+}
+
+// The values are the same for every percentage, which of them are inserts
+// is not.
+const std::vector<mixed_operation>& mixed_operations(int insert_percentage) {
+  static std::map<int, std::vector<mixed_operation>> cached_operations;
+
+  auto found = cached_operations.find(insert_percentage);
+  if (found == cached_operations.end()) {
+    std::mt19937 g(static_cast<unsigned>(insert_percentage));
+    std::uniform_int_distribution<> percent(0, 99);
+    std::vector<mixed_operation> res;
+    for (int value : mixed_generator().batch<int>(c_mixed_operations))
+      res.push_back({percent(g) < insert_percentage, value});
+    found = cached_operations.emplace(insert_percentage, std::move(res)).first;
+  }
+  return found->second;
+}
+
+template <typename C>
+C make_mixed_set(const int_vec& sorted) {
+  return C(sorted.begin(), sorted.end());
+}
+
+void mixed_insert(int_vec& c, int x) {
+  bulk_insert::one_at_a_time(c, &x, &x + 1, std::less<>{});
+}
+
+template <typename C>
+void mixed_insert(C& c, int x) {
+  c.insert(x);
+}
+
+bool mixed_contains(const int_vec& c, int x) {
+  return std::binary_search(c.begin(), c.end(), x);
+}
+
+bool mixed_contains(const std::set<int>& c, int x) {
+  return c.count(x) != 0;
+}
+
+template <typename C>
+bool mixed_contains(const C& c, int x) {
+  return c.contains(x);
+}
+
+// state.range(0) is the percentage of inserts, the rest are lookups.
+template <typename C>
+void benchmark_mixed(benchmark::State& state) {
+  const auto& operations = mixed_operations(static_cast<int>(state.range(0)));
+  const C already_in = make_mixed_set<C>(mixed_already_in());
+  helpers::run_on_copies(
+      state, already_in,
+      helpers::input_ring_size(mixed_already_in().size() * sizeof(int)),
+      [&](C& c) {
+        for (const auto& op : operations) {
+          if (op.insert)
+            mixed_insert(c, op.value);
+          else
+            benchmark::DoNotOptimize(mixed_contains(c, op.value));
+        }
+      });
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(operations.size()));
+}
+
+void mixed_boost_and_eastl_solution(benchmark::State& state) {
+  benchmark_mixed<int_vec>(state);
+}
+
+void mixed_std_set(benchmark::State& state) {
+  benchmark_mixed<std::set<int>>(state);
+}
+
+void mixed_buffered_flat_set(benchmark::State& state) {
+  benchmark_mixed<containers::buffered_flat_set<int>>(state);
+}
+
+void mixed_lsm_flat_set(benchmark::State& state) {
+  benchmark_mixed<containers::lsm_flat_set<int>>(state);
+}
+
+// Compressed sets -------------------------------------------------------------
+
+constexpr int c_compressed_key_spread = 16;
+constexpr size_t c_compressed_lookups = 1000;
+constexpr size_t c_compressed_batch = 100;
+
+using compressed_int_set = containers::compressed_flat_set<int>;
+using roaring_int_set = containers::roaring_set<int>;
+
+// About one in c_compressed_key_spread numbers is in the set.
+const workload::generator& compressed_generator(int size) {
+  static std::map<int, workload::generator> cached_generators;
+
+  auto found = cached_generators.find(size);
+  if (found == cached_generators.end()) {
+    const auto n = static_cast<size_t>(size);
+    found = cached_generators
+                .emplace(size, workload::generator(int_workload(
+                                   n, n * c_compressed_key_spread)))
+                .first;
+  }
+  return found->second;
+}
+
+const int_vec& compressed_already_in(int size) {
+  static std::map<int, int_vec> cached_res;
+
+  auto found = cached_res.find(size);
+  if (found == cached_res.end()) {
+    found =
+        cached_res.emplace(size, compressed_generator(size).set<int>()).first;
+  }
+  return found->second;
+}
+
+int_vec compressed_keys(int size, size_t count) {
+  return compressed_generator(size).batch<int>(count);
+}
+
+void compressed_insert(int_vec& c, const int_vec& batch) {
+  bulk_insert::use_end_buffer_precise(c, batch.begin(), batch.end(),
+                                      std::less<>{});
+}
+
+void compressed_insert(compressed_int_set& c, const int_vec& batch) {
+  c.insert(batch.begin(), batch.end());
+}
+
+size_t memory_bytes(const int_vec& c) {
+  return c.size() * sizeof(int);
+}
+
+size_t memory_bytes(const compressed_int_set& c) {
+  return c.memory_bytes();
+}
+
+size_t memory_bytes(const roaring_int_set& c) {
+  return c.memory_bytes();
+}
+
+template <typename C>
+void set_bytes_per_key(benchmark::State& state, const C& c) {
+  state.counters["bytes_per_key"] =
+      static_cast<double>(memory_bytes(c)) / static_cast<double>(c.size());
+}
+
+// state.range(0) is the set size.
+template <typename C>
+void benchmark_compressed_lookup(benchmark::State& state) {
+  const int size = static_cast<int>(state.range(0));
+  const auto& already_in = compressed_already_in(size);
+  const C c(already_in.begin(), already_in.end());
+  const auto keys = compressed_keys(size, c_compressed_lookups);
+
+  while (state.KeepRunning()) {
+    for (int key : keys)
+      benchmark::DoNotOptimize(mixed_contains(c, key));
+  }
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<int64_t>(keys.size()));
+  set_bytes_per_key(state, c);
+}
+
+// Inserts c_compressed_batch random keys into untimed copies of the set.
+template <typename C>
+void benchmark_compressed_bulk_insert(benchmark::State& state) {
+  const int size = static_cast<int>(state.range(0));
+  const auto& already_in = compressed_already_in(size);
+  const C c(already_in.begin(), already_in.end());
+  const auto batch = compressed_keys(size, c_compressed_batch);
+
+  helpers::run_on_copies(state, c, helpers::input_ring_size(memory_bytes(c)),
+                         [&](C& c_copy) {
+                           compressed_insert(c_copy, batch);
+                           benchmark::DoNotOptimize(c_copy.size());
+                         });
+  set_bytes_per_key(state, c);
+}
+
+void compressed_lookup_vector(benchmark::State& state) {
+  benchmark_compressed_lookup<int_vec>(state);
+}
+
+void compressed_lookup_compressed_flat_set(benchmark::State& state) {
+  benchmark_compressed_lookup<compressed_int_set>(state);
+}
+
+void compressed_bulk_insert_vector(benchmark::State& state) {
+  benchmark_compressed_bulk_insert<int_vec>(state);
+}
+
+void compressed_bulk_insert_compressed_flat_set(benchmark::State& state) {
+  benchmark_compressed_bulk_insert<compressed_int_set>(state);
+}
+
+void set_compressed_sizes(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(1000, 1000000);
+}
+
+// Dense sets ------------------------------------------------------------------
+
+constexpr size_t c_dense_batch = 1000;
+
+// density_percent of the numbers in [1, distribution_size] are in the set.
+workload::spec dense_workload(int density_percent) {
+  const auto n = workload_spec().distribution_size;
+  return int_workload(
+      static_cast<size_t>(n * static_cast<std::uint64_t>(density_percent) /
+                          100),
+      n);
+}
+
+const workload::generator& dense_generator(int density_percent) {
+  static std::map<int, workload::generator> cached_generators;
+
+  auto found = cached_generators.find(density_percent);
+  if (found == cached_generators.end()) {
+    found = cached_generators
+                .emplace(density_percent,
+                         workload::generator(dense_workload(density_percent)))
+                .first;
+  }
+  return found->second;
+}
+
+const int_vec& dense_already_in(int density_percent) {
+  static std::map<int, int_vec> cached_res;
+
+  auto found = cached_res.find(density_percent);
+  if (found == cached_res.end()) {
+    found = cached_res
+                .emplace(density_percent,
+                         dense_generator(density_percent).set<int>())
+                .first;
+  }
+  return found->second;
+}
+
+int_vec dense_batch(int density_percent) {
+  return dense_generator(density_percent).batch<int>(c_dense_batch);
+}
+
+// state.range(0) is the density in percent. Inserts c_dense_batch random
+// keys into untimed copies of the set.
+template <typename C, typename F>
+// requires BulkInsert<F, C>
+void benchmark_dense_insert(benchmark::State& state, F insertion_algorithm) {
+  const int density_percent = static_cast<int>(state.range(0));
+  const auto& already_in = dense_already_in(density_percent);
+  const C c(already_in.begin(), already_in.end());
+  const auto batch = dense_batch(density_percent);
+
+  helpers::run_on_copies(
+      state, c, helpers::input_ring_size(memory_bytes(c)), [&](C& c_copy) {
+        insertion_algorithm(c_copy, batch.begin(), batch.end(), std::less<>{});
+        benchmark::DoNotOptimize(c_copy.size());
+      });
+  set_bytes_per_key(state, c);
+}
+
+void dense_use_end_buffer_precise(benchmark::State& state) {
+  benchmark_dense_insert<int_vec>(state, [](auto& c, auto f, auto l, auto p) {
+    bulk_insert::use_end_buffer_precise(c, f, l, p);
+  });
+}
+
+void dense_stable_sort_and_unique(benchmark::State& state) {
+  benchmark_dense_insert<int_vec>(state, [](auto& c, auto f, auto l, auto p) {
+    bulk_insert::stable_sort_and_unique(c, f, l, p);
+  });
+}
+
+void dense_roaring_union(benchmark::State& state) {
+  benchmark_dense_insert<roaring_int_set>(
+      state, [](auto& c, auto f, auto l, auto p) {
+        bulk_insert::roaring_union(c, f, l, p);
+      });
+}
+
+void set_densities(benchmark::internal::Benchmark* bench) {
+  for (int percent : {1, 5, 25, 50, 90, 99})
+    bench->Arg(percent);
+}
+
+void set_insert_percentages(benchmark::internal::Benchmark* bench) {
+  for (int percentage : {1, 10, 25, 50, 75, 90, 99})
+    bench->Arg(percentage);
+}
+
+template <typename T>
+void register_bulk_insert_benchmarks() {
+  using benchmark_function = void (*)(benchmark::State&);
+  const std::pair<const char*, benchmark_function> benchmarks[] = {
+      {"baseline", baseline<T>},
+      {"benchmark_one_at_a_time", benchmark_one_at_a_time<T>},
+      {"benchmark_stable_sort_and_unique", benchmark_stable_sort_and_unique<T>},
+      {"benchmark_full_inplace_merge", benchmark_full_inplace_merge<T>},
+      {"benchmark_copy_unique_full_inplace_merge",
+       benchmark_copy_unique_full_inplace_merge<T>},
+      {"benchmark_copy_unique_inplace_merge_cache_begin",
+       benchmark_copy_unique_inplace_merge_cache_begin<T>},
+      {"benchmark_copy_unique_inplace_merge_upper_bound",
+       benchmark_copy_unique_inplace_merge_upper_bound<T>},
+      {"benchmark_copy_unique_inplace_merge_no_buffer",
+       benchmark_copy_unique_inplace_merge_no_buffer<T>},
+      {"benchmark_use_end_buffer_precise", benchmark_use_end_buffer_precise<T>},
+      {"benchmark_reallocate_and_merge", benchmark_reallocate_and_merge<T>},
+      {"benchmark_use_end_buffer_new_size",
+       benchmark_use_end_buffer_new_size<T>},
+      {"benchmark_btree_set", benchmark_btree_set<T>},
+      {"boost_and_eastl_solution", boost_and_eastl_solution<T>},
+      {"folly_solution", folly_solution<T>},
+      {"chromium_solution", chromium_solution<T>},
+      {"proposed_solution", proposed_solution<T>},
+  };
+
+  // The label is the method name for draw_benchmark_plot.py.
+  const auto sizes = workload::batch_sizes(workload_spec());
+  for (const auto& b : benchmarks) {
+    std::string method = b.first;
+    const std::string suffix = "_solution";
+    if (method.size() > suffix.size() &&
+        method.compare(method.size() - suffix.size(), suffix.size(),
+                       suffix) == 0)
+      method.resize(method.size() - suffix.size());
+    auto* bench = benchmark::RegisterBenchmark(
+        b.first, [method, f = b.second](benchmark::State& state) {
+          f(state);
+          state.SetLabel(method);
+        });
+    for (size_t size : sizes)
+      bench->Arg(static_cast<int64_t>(size));
+  }
+}
+
+void register_bulk_insert_benchmarks(workload::key_kind key) {
+  switch (key) {
+    case workload::key_kind::int32:
+      register_bulk_insert_benchmarks<std::int32_t>();
+      return;
+    case workload::key_kind::int64:
+      register_bulk_insert_benchmarks<std::int64_t>();
+      return;
+    case workload::key_kind::string:
+      register_bulk_insert_benchmarks<std::string>();
+      return;
+  }
+}
+
+BENCHMARK(mixed_boost_and_eastl_solution)->Apply(set_insert_percentages);
+BENCHMARK(mixed_std_set)->Apply(set_insert_percentages);
+BENCHMARK(mixed_buffered_flat_set)->Apply(set_insert_percentages);
+BENCHMARK(mixed_lsm_flat_set)->Apply(set_insert_percentages);
+
+BENCHMARK(compressed_lookup_vector)->Apply(set_compressed_sizes);
+BENCHMARK(compressed_lookup_compressed_flat_set)->Apply(set_compressed_sizes);
+BENCHMARK(compressed_bulk_insert_vector)->Apply(set_compressed_sizes);
+BENCHMARK(compressed_bulk_insert_compressed_flat_set)
+    ->Apply(set_compressed_sizes);
+
+BENCHMARK(dense_use_end_buffer_precise)->Apply(set_densities);
+BENCHMARK(dense_stable_sort_and_unique)->Apply(set_densities);
+BENCHMARK(dense_roaring_union)->Apply(set_densities);
 
 }  // namespace
 
-BENCHMARK_MAIN();
+// Takes the --workload_* flags (see workload::set_field) before the benchmark
+// library sees the rest, so that one binary covers every workload, e.g.:
+//   --workload_set_size=100 --workload_sweep=geometric
+//   --workload_spec=zipfian_strings.txt
+int main(int argc, char** argv) {
+  try {
+    workload_spec() = workload::parse_command_line(argc, argv);
+    // The mixed section needs more than c_mixed_set_size numbers.
+    workload::check(mixed_workload());
+    workload::check(dense_workload(99));
+  } catch (const std::exception& e) {
+    std::cerr << "bad workload: " << e.what() << '\n';
+    return 1;
+  }
+  register_bulk_insert_benchmarks(workload_spec().key);
+
+  for (const auto& field : workload::describe(workload_spec()))
+    benchmark::AddCustomContext(field.first, field.second);
+  for (const auto& field : helpers::build_context())
+    benchmark::AddCustomContext(field.first, field.second);
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace helpers {
+
+// Prepared inputs take about this much memory, so that they are still in
+// the cache when their turn comes, like a copy made right before.
+constexpr size_t c_input_ring_bytes = 1 << 20;
+constexpr size_t c_max_input_ring_size = 256;
+
+inline size_t input_ring_size(size_t bytes_per_input) {
+  return std::max<size_t>(
+      1, std::min(c_max_input_ring_size,
+                  c_input_ring_bytes / std::max<size_t>(1, bytes_per_input)));
+}
+
+// A benchmark loop for algorithms that change their input: times op(x) for
+// every x in the ring, then, with the timer paused, calls refill(ring) to
+// get them ready again. The timer is paused once per ring instead of once
+// per iteration, and nothing but op is timed.
+//
+// State is benchmark::State, Ring a container of inputs.
+template <typename State, typename Ring, typename Op, typename Refill>
+void run_on_ring(State& state, Ring& ring, Op op, Refill refill) {
+  const auto batch = static_cast<std::int64_t>(ring.size());
+  while (state.KeepRunningBatch(batch)) {
+    for (auto& x : ring)
+      op(x);
+    state.PauseTiming();
+    refill(ring);
+    state.ResumeTiming();
+  }
+}
+
+// run_on_ring for copies of original, ring_size of them.
+template <typename State, typename T, typename Op>
+void run_on_copies(State& state, const T& original, size_t ring_size, Op op) {
+  std::vector<T> ring(ring_size, original);
+  run_on_ring(state, ring, op, [&](std::vector<T>& copies) {
+    std::fill(copies.begin(), copies.end(), original);
+  });
+}
+
+}  // namespace helpers
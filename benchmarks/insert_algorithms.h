@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cassert>
 #include <iterator>
+#include <tuple>
 #include <vector>
 
 #include "benchmarks/bit_operations.h"
@@ -240,6 +241,42 @@ void use_end_buffer_impl(C& c, BufSize buf_size, I f, I l, P p) {
   c.erase(c.begin() + remaining_buf.first, c.begin() + remaining_buf.second);
 }
 
+// Returns a new container with the union of sorted and unique
+// [orig_f, orig_l) and [f, l). The original range is read first, then buf is
+// used as scratch space for the new elements.
+template <typename I1, typename C, typename I2, typename P>
+// requires ForwardIterator<I1> &&                         //
+//          Container<C> &&                                //
+//          ForwardIterator<I2> &&                         //
+//          StrictWeakOrdering<P, ValueType<C>> &&         //
+//          std::is_same_v<ValueType<C>, ValueType<I1>> && //
+//          std::is_same_v<ValueType<C>, ValueType<I2>>    //
+C reallocate_and_merge_impl(I1 orig_f, I1 orig_l, C& buf, I2 f, I2 l, P p) {
+  C new_c;
+  auto new_len = std::distance(f, l);
+  new_c.resize(static_cast<size_t>(std::distance(orig_f, orig_l) + new_len));
+  auto new_orig_l = helpers::strict_copy(orig_f, orig_l, new_c.begin());
+  buf.resize(static_cast<size_t>(new_len));
+  helpers::strict_copy(f, l, buf.begin());
+  std::sort(buf.begin(), buf.end(), p);
+  auto buf_l = std::unique(buf.begin(), buf.end(), helpers::not_fn(p));
+
+  using reverse_it = typename C::reverse_iterator;
+  auto move_reverse_it =
+      [](auto it) { return std::make_move_iterator(reverse_it(it)); };
+
+  auto reverse_remainig_buf_range =
+      helpers::set_union_adaptive_into_tail<helpers::copy_traits>(
+          reverse_it(new_c.end()),                               // buffer
+          reverse_it(new_orig_l), reverse_it(new_c.begin()),     // original
+          move_reverse_it(buf_l), move_reverse_it(buf.begin()),  // new elements
+          helpers::strict_oposite(p));                           // greater
+
+  new_c.erase(reverse_remainig_buf_range.second.base(),
+              reverse_remainig_buf_range.first.base());
+  return new_c;
+}
+
 }  // helpers
 
 namespace bulk_insert {
@@ -395,31 +432,11 @@ template <typename C, typename I, typename P>
 //          StrictWeakOrdering<P, ValueType<C>> &&      //
 //          std::is_same_v<ValueType<C>, ValueType<I>>  //
 void reallocate_and_merge(C& c, I f, I l, P p) {
-  C new_c;
-  auto new_len = std::distance(f, l);
-  new_c.resize(c.size() + new_len);
-  auto orig_l =
-      helpers::strict_copy(std::make_move_iterator(c.begin()),
-                           std::make_move_iterator(c.end()), new_c.begin());
-  c.resize(std::distance(f, l));
-  helpers::strict_copy(f, l, c.begin());
-  std::sort(c.begin(), c.end(), p);
-  auto c_l = std::unique(c.begin(), c.end(), helpers::not_fn(p));
-
-  using reverse_it = typename C::reverse_iterator;
-  auto move_reverse_it =
-      [](auto it) { return std::make_move_iterator(reverse_it(it)); };
-
-  auto reverse_remainig_buf_range =
-      helpers::set_union_adaptive_into_tail<helpers::copy_traits>(
-          reverse_it(new_c.end()),                           // buffer
-          reverse_it(orig_l), reverse_it(new_c.begin()),     // original
-          move_reverse_it(c_l), move_reverse_it(c.begin()),  // new elements
-          helpers::strict_oposite(p));                       // greater
-
-  new_c.erase(reverse_remainig_buf_range.second.base(),
-              reverse_remainig_buf_range.first.base());
-  c = std::move(new_c);
+  // c is both the source and the scratch buffer: its elements are moved out
+  // before it's reused.
+  c = helpers::reallocate_and_merge_impl(std::make_move_iterator(c.begin()),
+                                         std::make_move_iterator(c.end()), c,
+                                         f, l, p);
 }
 
 template <typename C, typename I, typename P>
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace helpers {
+
+// What instrumented, counting_predicate and counting_allocator did so far,
+// for all threads.
+struct operation_counts {
+  std::size_t comparisons = 0;
+  std::size_t copies = 0;
+  std::size_t moves = 0;
+  std::size_t swaps = 0;
+  std::size_t allocations = 0;
+};
+
+namespace instrumentation {
+
+struct counters {
+  std::atomic<std::size_t> comparisons{0};
+  std::atomic<std::size_t> copies{0};
+  std::atomic<std::size_t> moves{0};
+  std::atomic<std::size_t> swaps{0};
+  std::atomic<std::size_t> allocations{0};
+};
+
+inline counters& global() {
+  static counters res;
+  return res;
+}
+
+inline void add(std::atomic<std::size_t>& counter) {
+  counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline operation_counts snapshot() {
+  const auto& c = global();
+  operation_counts res;
+  res.comparisons = c.comparisons.load(std::memory_order_relaxed);
+  res.copies = c.copies.load(std::memory_order_relaxed);
+  res.moves = c.moves.load(std::memory_order_relaxed);
+  res.swaps = c.swaps.load(std::memory_order_relaxed);
+  res.allocations = c.allocations.load(std::memory_order_relaxed);
+  return res;
+}
+
+}  // namespace instrumentation
+
+// Counts the operations from its construction on.
+//
+//   operation_counter counter;
+//   bulk_insert::use_end_buffer_precise(c, f, l, counting_predicate<>{});
+//   counter.report(state);
+class operation_counter {
+ public:
+  operation_counter() : start_(instrumentation::snapshot()) {}
+
+  operation_counts counts() const {
+    const auto now = instrumentation::snapshot();
+    operation_counts res;
+    res.comparisons = now.comparisons - start_.comparisons;
+    res.copies = now.copies - start_.copies;
+    res.moves = now.moves - start_.moves;
+    res.swaps = now.swaps - start_.swaps;
+    res.allocations = now.allocations - start_.allocations;
+    return res;
+  }
+
+  // Adds the counts as benchmark counters, State is benchmark::State.
+  template <typename State>
+  void report(State& state) const {
+    const auto res = counts();
+    state.counters["comparisons"] = static_cast<double>(res.comparisons);
+    state.counters["copies"] = static_cast<double>(res.copies);
+    state.counters["moves"] = static_cast<double>(res.moves);
+    state.counters["swaps"] = static_cast<double>(res.swaps);
+    state.counters["allocations"] = static_cast<double>(res.allocations);
+  }
+
+ private:
+  operation_counts start_;
+};
+
+// A key that counts its copies, moves, swaps and comparisons. Comparing the
+// parts of a key, like x[0], is not counted.
+template <typename T>
+class instrumented {
+ public:
+  using value_type = T;
+
+  instrumented() = default;
+  explicit instrumented(T value) : value_(std::move(value)) {}
+
+  instrumented(const instrumented& x) : value_(x.value_) {
+    instrumentation::add(instrumentation::global().copies);
+  }
+
+  instrumented(instrumented&& x) noexcept : value_(std::move(x.value_)) {
+    instrumentation::add(instrumentation::global().moves);
+  }
+
+  instrumented& operator=(const instrumented& x) {
+    instrumentation::add(instrumentation::global().copies);
+    value_ = x.value_;
+    return *this;
+  }
+
+  instrumented& operator=(instrumented&& x) noexcept {
+    instrumentation::add(instrumentation::global().moves);
+    value_ = std::move(x.value_);
+    return *this;
+  }
+
+  friend void swap(instrumented& x, instrumented& y) noexcept {
+    instrumentation::add(instrumentation::global().swaps);
+    using std::swap;
+    swap(x.value_, y.value_);
+  }
+
+  const T& value() const { return value_; }
+
+  template <typename I>
+  decltype(auto) operator[](I i) const {
+    return value_[i];
+  }
+
+  friend bool operator<(const instrumented& x, const instrumented& y) {
+    instrumentation::add(instrumentation::global().comparisons);
+    return x.value_ < y.value_;
+  }
+
+  friend bool operator==(const instrumented& x, const instrumented& y) {
+    instrumentation::add(instrumentation::global().comparisons);
+    return x.value_ == y.value_;
+  }
+
+  friend bool operator!=(const instrumented& x, const instrumented& y) {
+    return !(x == y);
+  }
+  friend bool operator>(const instrumented& x, const instrumented& y) {
+    return y < x;
+  }
+  friend bool operator<=(const instrumented& x, const instrumented& y) {
+    return !(y < x);
+  }
+  friend bool operator>=(const instrumented& x, const instrumented& y) {
+    return !(x < y);
+  }
+
+ private:
+  T value_;
+};
+
+// Counts the calls of P, for keys that can't be wrapped.
+template <typename P = std::less<>>
+// requires StrictWeakOrdering<P>
+struct counting_predicate {
+  counting_predicate() = default;
+  explicit counting_predicate(P p) : p_(std::move(p)) {}
+
+  template <typename T, typename U>
+  bool operator()(const T& x, const U& y) const {
+    instrumentation::add(instrumentation::global().comparisons);
+    return p_(x, y);
+  }
+
+ private:
+  P p_;
+};
+
+// std::allocator that counts the calls to allocate.
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+  template <typename U>
+  struct rebind {
+    using other = counting_allocator<U>;
+  };
+
+  counting_allocator() = default;
+  template <typename U>
+  counting_allocator(const counting_allocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    instrumentation::add(instrumentation::global().allocations);
+    return std::allocator<T>::allocate(n);
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const counting_allocator<T>&, const counting_allocator<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const counting_allocator<T>&, const counting_allocator<U>&) {
+  return false;
+}
+
+}  // namespace helpers
@@ -1,5 +1,10 @@
-#include "third_party/benchmark/include/benchmark/benchmark.h"
+#include "benchmark/benchmark.h"
 
+#include "benchmarks/allocation_tracking.h"
+#include "benchmarks/input_ring.h"
+#include "benchmarks/perf_counters.h"
+
+#include <deque>
 #include <memory>
 #include <random>
 #include <list>
@@ -139,13 +144,26 @@ __attribute__((noinline)) list_node<size_t>* generate_sequence_unrolled(
 template <typename Allocator, typename Gen>
 void generate_list_benchmark(benchmark::State& state, Gen gen) {
   size_t n = static_cast<size_t>(state.range(0));
-  Allocator alloc(n);
-  while (state.KeepRunning()) {
-    gen(n, alloc);
-    state.PauseTiming();
-    alloc.free();
-    state.ResumeTiming();
-  }
+  // Allocators are not movable, deque doesn't need it.
+  std::deque<Allocator> ring;
+  const size_t ring_size =
+      helpers::input_ring_size(n * sizeof(list_node<size_t>));
+  for (size_t i = 0; i != ring_size; ++i)
+    ring.emplace_back(n);
+
+  helpers::perf_counters counters;
+  counters.start();
+  helpers::run_on_ring(state, ring, [&](Allocator& alloc) { gen(n, alloc); },
+                       [&](std::deque<Allocator>& allocs) {
+                         counters.pause();
+                         for (auto& alloc : allocs)
+                           alloc.free();
+                         counters.resume();
+                       });
+  counters.stop();
+  counters.report(state);
+  Allocator one_more(n);
+  helpers::report_allocations_of_one(state, [&] { gen(n, one_more); });
 }
 
 template <typename Allocator>
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace helpers {
+namespace disk {
+
+// File layout, all sections start at a multiple of c_section_alignment:
+//   file_header
+//   keys    [count]
+//   values  [count], maps only
+//   index   [ceil(count / stride)], optional: every stride-th key
+// Everything is in the writer's byte order, the files are not portable
+// between architectures.
+constexpr char c_magic[8] = {'F', 'L', 'A', 'T', 'S', 'E', 'T', '\0'};
+constexpr std::uint32_t c_format_version = 1;
+constexpr std::uint64_t c_section_alignment = 64;
+constexpr std::uint64_t c_index_stride = 64;
+
+enum class file_kind : std::uint32_t { set = 1, map = 2 };
+
+struct file_header {
+  char magic[8];
+  std::uint32_t version;
+  file_kind kind;
+  std::uint64_t key_size;
+  std::uint64_t value_size;  // 0 for sets
+  std::uint64_t count;
+  std::uint64_t keys_offset;
+  std::uint64_t values_offset;  // 0 for sets
+  std::uint64_t index_offset;   // 0 without an index
+  std::uint64_t index_stride;
+};
+
+inline std::uint64_t align_section(std::uint64_t offset) {
+  return (offset + c_section_alignment - 1) / c_section_alignment *
+         c_section_alignment;
+}
+
+inline std::uint64_t index_size(std::uint64_t count, std::uint64_t stride) {
+  return count / stride + (count % stride != 0);
+}
+
+[[noreturn]] inline void throw_errno(const std::string& what) {
+  throw std::system_error(errno, std::generic_category(), what);
+}
+
+[[noreturn]] inline void throw_bad_file(const char* what) {
+  throw std::runtime_error(std::string("bad flat set file: ") + what);
+}
+
+// Read only, private mapping of a whole file.
+class mapped_file {
+ public:
+  explicit mapped_file(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw_errno("open " + path);
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw_errno("fstat " + path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ != 0) {
+      void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        throw_errno("mmap " + path);
+      }
+      data_ = static_cast<const char*>(p);
+    }
+    // The mapping stays valid after close.
+    ::close(fd);
+  }
+
+  mapped_file(mapped_file&& x) noexcept : data_(x.data_), size_(x.size_) {
+    x.data_ = nullptr;
+    x.size_ = 0;
+  }
+
+  mapped_file& operator=(mapped_file&& x) noexcept {
+    std::swap(data_, x.data_);
+    std::swap(size_, x.size_);
+    return *this;
+  }
+
+  ~mapped_file() {
+    if (data_)
+      ::munmap(const_cast<char*>(data_), size_);
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Checks the header against what the caller expects and that every section
+// fits into the file.
+inline const file_header& checked_header(const mapped_file& file,
+                                         file_kind kind,
+                                         size_t key_size,
+                                         size_t value_size) {
+  if (file.size() < sizeof(file_header))
+    throw_bad_file("too small");
+  const auto& h = *reinterpret_cast<const file_header*>(file.data());
+  if (std::memcmp(h.magic, c_magic, sizeof(c_magic)) != 0)
+    throw_bad_file("magic");
+  if (h.version != c_format_version)
+    throw_bad_file("version");
+  if (h.kind != kind || h.key_size != key_size || h.value_size != value_size)
+    throw_bad_file("element type");
+
+  // Divides instead of multiplying, a crafted count can't wrap around.
+  auto fits = [&](std::uint64_t offset, std::uint64_t count,
+                  std::uint64_t element_size) {
+    return offset % c_section_alignment == 0 && offset <= file.size() &&
+           (element_size == 0 ||
+            count <= (file.size() - offset) / element_size);
+  };
+  if (!fits(h.keys_offset, h.count, key_size))
+    throw_bad_file("keys");
+  if (kind == file_kind::map && !fits(h.values_offset, h.count, value_size))
+    throw_bad_file("values");
+  if (h.index_offset != 0 &&
+      (h.index_stride == 0 ||
+       !fits(h.index_offset, index_size(h.count, h.index_stride), key_size)))
+    throw_bad_file("index");
+  return h;
+}
+
+class file_writer {
+ public:
+  explicit file_writer(const std::string& path)
+      : path_(path), out_(path, std::ios::binary | std::ios::trunc) {
+    if (!out_)
+      throw_errno("create " + path);
+  }
+
+  std::uint64_t offset() const { return offset_; }
+
+  void write(const void* p, std::uint64_t bytes) {
+    out_.write(static_cast<const char*>(p),
+               static_cast<std::streamsize>(bytes));
+    offset_ += bytes;
+  }
+
+  void pad_to(std::uint64_t offset) {
+    static const char zeros[c_section_alignment] = {};
+    write(zeros, offset - offset_);
+  }
+
+  void rewrite_header(const file_header& h) {
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out_.flush();
+    if (!out_)
+      throw_errno("write " + path_);
+  }
+
+ private:
+  std::string path_;
+  std::ofstream out_;
+  std::uint64_t offset_ = 0;
+};
+
+// Writes the header, keys, values (if any) and the index (if asked for).
+template <typename K, typename V>
+void write_file(const std::string& path,
+                file_kind kind,
+                const K* keys,
+                const V* values,
+                std::uint64_t count,
+                bool with_index) {
+  file_header h = {};
+  std::memcpy(h.magic, c_magic, sizeof(c_magic));
+  h.version = c_format_version;
+  h.kind = kind;
+  h.key_size = sizeof(K);
+  h.value_size = values ? sizeof(V) : 0;
+  h.count = count;
+  h.index_stride = c_index_stride;
+
+  file_writer out(path);
+  out.write(&h, sizeof(h));
+
+  h.keys_offset = align_section(out.offset());
+  out.pad_to(h.keys_offset);
+  out.write(keys, count * sizeof(K));
+
+  if (values) {
+    h.values_offset = align_section(out.offset());
+    out.pad_to(h.values_offset);
+    out.write(values, count * sizeof(V));
+  }
+
+  if (with_index) {
+    h.index_offset = align_section(out.offset());
+    out.pad_to(h.index_offset);
+    for (std::uint64_t i = 0; i < count; i += c_index_stride)
+      out.write(keys + i, sizeof(K));
+  }
+
+  out.rewrite_header(h);
+}
+
+// Searches the sampled index first, then only one stride of keys.
+template <typename K, typename P>
+// requires StrictWeakOrdering<P, K>
+const K* indexed_lower_bound(const K* f,
+                             const K* l,
+                             const K* index_f,
+                             const K* index_l,
+                             std::uint64_t stride,
+                             const K& key,
+                             P p) {
+  if (index_f == index_l)
+    return std::lower_bound(f, l, key, p);
+  // The first sample that is not less than key bounds the answer from
+  // above, the one before it from below.
+  const auto i = static_cast<std::uint64_t>(
+      std::lower_bound(index_f, index_l, key, p) - index_f);
+  const K* window_f = i == 0 ? f : f + (i - 1) * stride + 1;
+  const K* window_l = i == static_cast<std::uint64_t>(index_l - index_f)
+                          ? l
+                          : f + i * stride;
+  return std::lower_bound(window_f, window_l, key, p);
+}
+
+}  // namespace disk
+}  // namespace helpers
+
+namespace containers {
+
+// Writes a sorted and unique vector in the mapped_flat_set format.
+template <typename T>
+// requires TriviallyCopyable<T>
+void save_flat_set(const std::string& path,
+                   const std::vector<T>& sorted,
+                   bool with_index = true) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "keys are written as raw bytes");
+  helpers::disk::write_file(path, helpers::disk::file_kind::set,
+                            sorted.data(), static_cast<const char*>(nullptr),
+                            sorted.size(), with_index);
+}
+
+// Writes a map with sorted and unique keys and values[i] for keys[i].
+template <typename K, typename V>
+// requires TriviallyCopyable<K> && TriviallyCopyable<V>
+void save_flat_map(const std::string& path,
+                   const std::vector<K>& keys,
+                   const std::vector<V>& values,
+                   bool with_index = true) {
+  static_assert(std::is_trivially_copyable<K>::value &&
+                    std::is_trivially_copyable<V>::value,
+                "keys and values are written as raw bytes");
+  if (keys.size() != values.size())
+    throw std::invalid_argument("keys and values differ in size");
+  helpers::disk::write_file(path, helpers::disk::file_kind::map, keys.data(),
+                            values.data(), keys.size(), with_index);
+}
+
+// Read only view of a file written by save_flat_set. Opening it maps the
+// file and checks the header, nothing is copied or deserialized: pages are
+// read in by the first accesses to them.
+template <typename T, typename P = std::less<>>
+// requires TriviallyCopyable<T> && StrictWeakOrdering<P, T>
+class mapped_flat_set {
+ public:
+  using value_type = T;
+  using const_iterator = const T*;
+
+  explicit mapped_flat_set(const std::string& path, P p = P{})
+      : p_(p), file_(path) {
+    const auto& h = helpers::disk::checked_header(
+        file_, helpers::disk::file_kind::set, sizeof(T), 0);
+    f_ = reinterpret_cast<const T*>(file_.data() + h.keys_offset);
+    l_ = f_ + h.count;
+    if (h.index_offset != 0) {
+      index_f_ = reinterpret_cast<const T*>(file_.data() + h.index_offset);
+      index_l_ = index_f_ + helpers::disk::index_size(h.count, h.index_stride);
+      stride_ = h.index_stride;
+    }
+  }
+
+  const_iterator begin() const { return f_; }
+  const_iterator end() const { return l_; }
+  size_t size() const { return static_cast<size_t>(l_ - f_); }
+  bool empty() const { return f_ == l_; }
+  bool has_index() const { return index_f_ != index_l_; }
+
+  const_iterator lower_bound(const T& x) const {
+    return helpers::disk::indexed_lower_bound(f_, l_, index_f_, index_l_,
+                                              stride_, x, p_);
+  }
+
+  bool contains(const T& x) const {
+    auto it = lower_bound(x);
+    return it != l_ && !p_(x, *it);
+  }
+
+ private:
+  P p_;
+  helpers::disk::mapped_file file_;
+  const T* f_ = nullptr;
+  const T* l_ = nullptr;
+  const T* index_f_ = nullptr;
+  const T* index_l_ = nullptr;
+  std::uint64_t stride_ = 0;
+};
+
+// Read only view of a file written by save_flat_map. Keys and values are
+// separate arrays, like in split_flat_map.
+template <typename K, typename V, typename P = std::less<>>
+// requires TriviallyCopyable<K> && TriviallyCopyable<V> &&
+//          StrictWeakOrdering<P, K>
+class mapped_flat_map {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using const_iterator = const K*;
+
+  explicit mapped_flat_map(const std::string& path, P p = P{})
+      : p_(p), file_(path) {
+    const auto& h = helpers::disk::checked_header(
+        file_, helpers::disk::file_kind::map, sizeof(K), sizeof(V));
+    f_ = reinterpret_cast<const K*>(file_.data() + h.keys_offset);
+    l_ = f_ + h.count;
+    values_ = reinterpret_cast<const V*>(file_.data() + h.values_offset);
+    if (h.index_offset != 0) {
+      index_f_ = reinterpret_cast<const K*>(file_.data() + h.index_offset);
+      index_l_ = index_f_ + helpers::disk::index_size(h.count, h.index_stride);
+      stride_ = h.index_stride;
+    }
+  }
+
+  // Iterates over keys, value(it) is the matching value.
+  const_iterator begin() const { return f_; }
+  const_iterator end() const { return l_; }
+  size_t size() const { return static_cast<size_t>(l_ - f_); }
+  bool empty() const { return f_ == l_; }
+
+  const V& value(const_iterator it) const { return values_[it - f_]; }
+
+  const_iterator lower_bound(const K& key) const {
+    return helpers::disk::indexed_lower_bound(f_, l_, index_f_, index_l_,
+                                              stride_, key, p_);
+  }
+
+  // nullptr if there is no such key.
+  const V* find(const K& key) const {
+    auto it = lower_bound(key);
+    if (it == l_ || p_(key, *it))
+      return nullptr;
+    return &value(it);
+  }
+
+ private:
+  P p_;
+  helpers::disk::mapped_file file_;
+  const K* f_ = nullptr;
+  const K* l_ = nullptr;
+  const V* values_ = nullptr;
+  const K* index_f_ = nullptr;
+  const K* index_l_ = nullptr;
+  std::uint64_t stride_ = 0;
+};
+
+}  // namespace containers
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "benchmarks/allocation_tracking.h"
+#include "benchmarks/insert_algorithms.h"
+#include "benchmarks/mapped_flat_set.h"
+
+#include "benchmark/benchmark.h"
+
+namespace {
+
+using int_vec = std::vector<int>;
+using clock_type = std::chrono::steady_clock;
+
+// Unsorted keys with duplicates, what a process would rebuild from.
+const int_vec& raw_keys(size_t size) {
+  static std::map<size_t, int_vec> cached_keys;
+
+  auto found = cached_keys.find(size);
+  if (found == cached_keys.end()) {
+    std::mt19937 g;
+    std::uniform_int_distribution<> dis(0, static_cast<int>(size * 2));
+    int_vec res(size);
+    std::generate(res.begin(), res.end(), [&] { return dis(g); });
+    found = cached_keys.emplace(size, std::move(res)).first;
+  }
+  return found->second;
+}
+
+int first_query(size_t size) {
+  return static_cast<int>(size);
+}
+
+// Files are written once per size and removed at exit.
+class saved_sets {
+ public:
+  ~saved_sets() {
+    for (const auto& file : files_)
+      std::remove(file.second.c_str());
+  }
+
+  const std::string& path(size_t size, bool with_index) {
+    auto found = files_.find({size, with_index});
+    if (found == files_.end()) {
+      int_vec sorted;
+      bulk_insert::stable_sort_and_unique(sorted, raw_keys(size).begin(),
+                                          raw_keys(size).end(), std::less<>{});
+      const std::string path = "/tmp/mapped_flat_set_benchmark_" +
+                               std::to_string(::getpid()) + "_" +
+                               std::to_string(size) +
+                               (with_index ? "_index" : "") + ".bin";
+      containers::save_flat_set(path, sorted, with_index);
+      found = files_.emplace(std::make_pair(size, with_index), path).first;
+    }
+    return found->second;
+  }
+
+ private:
+  std::map<std::pair<size_t, bool>, std::string> files_;
+};
+
+saved_sets& files() {
+  static saved_sets res;
+  return res;
+}
+
+// Asks the kernel to forget the file's pages, so the next run reads them from
+// the disk. Returns false if that's not supported.
+bool drop_page_cache(const std::string& path) {
+#ifdef POSIX_FADV_DONTNEED
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  // Only clean pages are dropped.
+  ::fdatasync(fd);
+  const bool res = ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+  ::close(fd);
+  return res;
+#else
+  (void)path;
+  return false;
+#endif
+}
+
+double microseconds_since(clock_type::time_point start) {
+  return std::chrono::duration<double, std::micro>(clock_type::now() - start)
+      .count();
+}
+
+// Splits the measured time into getting the set ready and the first lookup.
+struct startup_counters {
+  void report(benchmark::State& state) {
+    const auto n = static_cast<double>(state.iterations());
+    state.counters["load_us"] = load_us / n;
+    state.counters["first_query_us"] = first_query_us / n;
+  }
+
+  double load_us = 0;
+  double first_query_us = 0;
+};
+
+// state.range(0) is the number of keys.
+void startup_stable_sort_and_unique(benchmark::State& state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto& keys = raw_keys(size);
+  startup_counters counters;
+  helpers::allocation_tracker allocations;
+
+  while (state.KeepRunning()) {
+    auto start = clock_type::now();
+    int_vec c;
+    bulk_insert::stable_sort_and_unique(c, keys.begin(), keys.end(),
+                                        std::less<>{});
+    counters.load_us += microseconds_since(start);
+
+    start = clock_type::now();
+    benchmark::DoNotOptimize(
+        std::lower_bound(c.begin(), c.end(), first_query(size)));
+    counters.first_query_us += microseconds_since(start);
+  }
+  counters.report(state);
+  allocations.report(state);
+}
+
+// state.range(0) is the number of keys, state.range(1) says whether the
+// file has a search index, state.range(2) whether the page cache is dropped
+// before every run.
+void startup_mapped_flat_set(benchmark::State& state) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto& path = files().path(size, state.range(1) != 0);
+  const bool cold = state.range(2) != 0;
+  startup_counters counters;
+  helpers::allocation_tracker allocations;
+  bool dropped = true;
+
+  while (state.KeepRunning()) {
+    if (cold) {
+      state.PauseTiming();
+      dropped = drop_page_cache(path) && dropped;
+      state.ResumeTiming();
+    }
+
+    auto start = clock_type::now();
+    const containers::mapped_flat_set<int> c(path);
+    counters.load_us += microseconds_since(start);
+
+    start = clock_type::now();
+    benchmark::DoNotOptimize(c.lower_bound(first_query(size)));
+    counters.first_query_us += microseconds_since(start);
+  }
+  counters.report(state);
+  allocations.report(state);
+  if (cold)
+    state.counters["page_cache_dropped"] = dropped;
+}
+
+void set_sizes(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(100000, 10000000);
+  bench->Unit(benchmark::kMicrosecond);
+}
+
+void set_mapped_options(benchmark::internal::Benchmark* bench) {
+  bench->ArgNames({"size", "index", "cold"});
+  for (int64_t size = 100000; size <= 10000000; size *= 10) {
+    for (int64_t index : {0, 1}) {
+      for (int64_t cold : {0, 1})
+        bench->Args({size, index, cold});
+    }
+  }
+  bench->Unit(benchmark::kMicrosecond);
+}
+
+BENCHMARK(startup_stable_sort_and_unique)->Apply(set_sizes);
+BENCHMARK(startup_mapped_flat_set)->Apply(set_mapped_options);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -1,9 +1,27 @@
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
 #include <vector>
 #include <random>
 #include <iostream>
 
+#include "benchmarks/allocation_tracking.h"
+#include "benchmarks/comparators.h"
+#include "benchmarks/input_ring.h"
+#include "benchmarks/insert_algorithms.h"
+#include "benchmarks/instrumented.h"
+#include "benchmarks/parallel_selection.h"
+#include "benchmarks/perf_counters.h"
+#include "benchmarks/selection.h"
+#include "benchmarks/simd_selection.h"
+#include "benchmarks/streaming_selection.h"
+
 #include "benchmark/benchmark.h"
 
 namespace {
@@ -12,29 +30,192 @@ using value_type = std::array<int64_t, 3>;
 constexpr size_t kArraySize = 2000;
 constexpr size_t kNthElement = 200;
 
-static const std::vector<value_type>& inputs() {
-  static const auto cached_inputs = [] {
-    std::vector<value_type> res(kArraySize);
-
-    for (auto& x : res) {
-      std::generate(x.begin(), x.end(), [] {
-        static std::mt19937 g;
-        static std::uniform_int_distribution<> dis(1, 10000);
-        return dis(g);
-      });
-    }
-    return res;
-  }();
+// Frees the inputs last_inputs holds on to.
+std::function<void()>& release_last_inputs() {
+  static std::function<void()> release;
+  return release;
+}
+
+// Only the last inputs asked for are kept: a benchmark goes through its
+// sizes one after another and the big ones don't fit in memory together.
+// The reference is valid until the next call for other inputs.
+template <typename T, typename Make>
+const std::vector<T>& last_inputs(size_t size, Make make) {
+  static std::vector<T> cached_inputs;
+  static bool cached = false;
+
+  if (!cached || cached_inputs.size() != size) {
+    if (release_last_inputs())
+      release_last_inputs()();
+    cached_inputs = make(size);
+    cached = true;
+    release_last_inputs() = [] {
+      cached_inputs = std::vector<T>();
+      cached = false;
+    };
+  }
+  return cached_inputs;
+}
+
+std::vector<value_type> make_inputs(size_t size) {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(1, 10000);
+  std::vector<value_type> res(size);
+
+  for (auto& x : res)
+    std::generate(x.begin(), x.end(), [&] { return dis(g); });
+  return res;
+}
 
+static const std::vector<value_type>& inputs() {
+  static const std::vector<value_type> cached_inputs = make_inputs(kArraySize);
   return cached_inputs;
 }
 
+constexpr size_t kMinArithmeticArraySize = 2000;
+constexpr size_t kMaxArithmeticArraySize = 100000000;
+
+template <typename T>
+T random_arithmetic_value(std::mt19937& g) {
+  static std::uniform_int_distribution<std::int64_t> dis(-1000000000,
+                                                         1000000000);
+  return static_cast<T>(dis(g));
+}
+
+// Up to kMaxArithmeticArraySize, kHugeParallelArraySize with
+// --parallel_huge, see last_inputs.
+template <typename T>
+const std::vector<T>& arithmetic_inputs(size_t size) {
+  return last_inputs<T>(size, [](size_t n) {
+    std::mt19937 g;
+    std::vector<T> res(n);
+    std::generate(res.begin(), res.end(),
+                  [&] { return random_arithmetic_value<T>(g); });
+    return res;
+  });
+}
+
+// Inputs are copied untimed, see input_ring.h.
 template <typename F>
 void benchmark_nth_element(benchmark::State& state, F f) {
-  while (state.KeepRunning()) {
-    auto input_copy = inputs();
-    f(input_copy.begin(), input_copy.begin() + kNthElement, input_copy.end());
-  }
+  using input_type = std::vector<value_type>;
+  std::vector<input_type> ring(
+      helpers::input_ring_size(kArraySize * sizeof(value_type)), inputs());
+
+  helpers::allocation_tracker allocations;
+  helpers::perf_counters counters;
+  counters.start();
+  helpers::run_on_ring(
+      state, ring,
+      [&](input_type& input) {
+        f(input.begin(), input.begin() + kNthElement, input.end());
+      },
+      [&](std::vector<input_type>& copies) {
+        counters.pause();
+        std::fill(copies.begin(), copies.end(), inputs());
+        counters.resume();
+      });
+  counters.stop();
+  counters.report(state);
+  allocations.report(state);
+}
+
+// Times g(f, m, l, Compare{}) and reports the comparisons of one more,
+// untimed, call.
+template <typename Compare, typename G>
+void benchmark_nth_element_counted(benchmark::State& state, G g) {
+  benchmark_nth_element(
+      state, [&](auto f, auto m, auto l) { g(f, m, l, Compare{}); });
+
+  auto input_copy = inputs();
+  helpers::operation_counter counter;
+  g(input_copy.begin(), input_copy.begin() + kNthElement, input_copy.end(),
+    helpers::counting_predicate<Compare>{});
+  state.counters["comparisons"] =
+      static_cast<double>(counter.counts().comparisons);
+}
+
+// state.range(0) is k/N in per mille.
+template <typename F>
+void benchmark_top_k(benchmark::State& state, F f) {
+  const auto k = std::max<size_t>(
+      1, kArraySize * static_cast<size_t>(state.range(0)) / 1000);
+  const auto ring_size =
+      helpers::input_ring_size(kArraySize * sizeof(value_type));
+  helpers::run_on_copies(
+      state, inputs(), ring_size, [&](std::vector<value_type>& input) {
+        f(input.begin(), input.begin() + k, input.end());
+      });
+}
+
+auto first_key(const value_type& x) {
+  return x[0];
+}
+
+auto compare_first_key() {
+  return [](const value_type& lhs, const value_type& rhs) {
+    return lhs[0] < rhs[0];
+  };
+}
+
+// The nth element is at the same relative position as kNthElement.
+template <typename T, typename F>
+void benchmark_arithmetic_nth_element(benchmark::State& state, F f) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto& input = arithmetic_inputs<T>(size);
+  const auto nth = size / (kArraySize / kNthElement);
+  helpers::run_on_copies(state, input,
+                         helpers::input_ring_size(size * sizeof(T)),
+                         [&](std::vector<T>& input_copy) {
+                           f(input_copy.begin(), input_copy.begin() + nth,
+                             input_copy.end());
+                         });
+}
+
+constexpr size_t kMinParallelArraySize = 1000000;
+constexpr size_t kMaxParallelArraySize = 100000000;
+// Only with --parallel_huge: the input, its copy and the scratch of
+// parallel_nth_element take about 26GB even for std::int64_t.
+constexpr size_t kHugeParallelArraySize = 1000000000;
+
+// Every thread count gets its own pool, the algorithms default to the shared
+// one.
+concurrency::thread_pool& pool_of_size(size_t threads) {
+  static std::map<size_t, std::unique_ptr<concurrency::thread_pool>> pools;
+  auto& pool = pools[threads];
+  if (!pool)
+    pool = std::make_unique<concurrency::thread_pool>(threads);
+  return *pool;
+}
+
+constexpr size_t kStreamTopK = 1000;
+constexpr double kStreamQuantile = 0.99;
+constexpr size_t kStreamShards = 8;
+constexpr size_t kMinStreamSize = 10000;
+constexpr size_t kMaxStreamSize = 10000000;
+
+// Feeds the input to f one element at a time, as it would come from a
+// stream, instead of copying the whole array.
+template <typename F>
+void benchmark_stream(benchmark::State& state, F f) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto& input = arithmetic_inputs<std::int64_t>(size);
+  while (state.KeepRunning())
+    benchmark::DoNotOptimize(f(input.begin(), input.end()));
+  state.SetItemsProcessed(state.iterations() *
+                          static_cast<std::int64_t>(size));
+}
+
+// Relative distance between the rank of the answer and the requested rank.
+void report_rank_error(benchmark::State& state, std::int64_t answer) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto& input = arithmetic_inputs<std::int64_t>(size);
+  const auto rank = std::count_if(input.begin(), input.end(),
+                                  [&](std::int64_t x) { return x < answer; });
+  const auto expected = kStreamQuantile * static_cast<double>(size);
+  state.counters["rank_error"] =
+      std::abs(static_cast<double>(rank) - expected) /
+      static_cast<double>(size);
 }
 
 void benchmark_empty(benchmark::State& state) {
@@ -50,9 +231,18 @@ void benchmark_only_first(benchmark::State& state) {
 }
 
 void benchmark_compare_all_default(benchmark::State& state) {
-  benchmark_nth_element(state, [](auto f, auto m, auto l) {
-    std::nth_element(f, m, l);
-  });
+  auto nth_element = [](auto f, auto m, auto l) { std::nth_element(f, m, l); };
+  benchmark_nth_element(state, nth_element);
+
+  // Default comparisons work on instrumented keys, so they count copies,
+  // moves and swaps too.
+  std::vector<helpers::instrumented<value_type>> input_copy;
+  for (const auto& x : inputs())
+    input_copy.emplace_back(x);
+  helpers::operation_counter counter;
+  nth_element(input_copy.begin(), input_copy.begin() + kNthElement,
+              input_copy.end());
+  counter.report(state);
 }
 
 void benchmark_compare_all_custom(benchmark::State& state) {
@@ -71,10 +261,322 @@ void benchmark_compare_all_custom(benchmark::State& state) {
   });
 }
 
+void benchmark_top_k_nth_element(benchmark::State& state) {
+  benchmark_top_k(state, [](auto f, auto m, auto l) {
+    std::nth_element(f, m, l, compare_first_key());
+  });
+}
+
+void benchmark_top_k_partial_sort(benchmark::State& state) {
+  benchmark_top_k(state, [](auto f, auto m, auto l) {
+    std::partial_sort(f, m, l, compare_first_key());
+  });
+}
+
+void benchmark_top_k_heap_select(benchmark::State& state) {
+  benchmark_top_k(state, [](auto f, auto m, auto l) {
+    selection::heap_select(f, m, l, compare_first_key());
+  });
+}
+
+void benchmark_top_k_nth_element_by_key(benchmark::State& state) {
+  benchmark_top_k(state, [](auto f, auto m, auto l) {
+    selection::nth_element_by_key(f, m, l, first_key);
+  });
+}
+
+void benchmark_top_k_partial_sort_by_key(benchmark::State& state) {
+  benchmark_top_k(state, [](auto f, auto m, auto l) {
+    selection::partial_sort_by_key(f, m, l, first_key);
+  });
+}
+
+template <typename T>
+void benchmark_arithmetic_empty(benchmark::State& state) {
+  benchmark_arithmetic_nth_element<T>(state, [](auto f, auto m, auto l) {});
+}
+
+template <typename T>
+void benchmark_arithmetic_std_nth_element(benchmark::State& state) {
+  benchmark_arithmetic_nth_element<T>(state, [](auto f, auto m, auto l) {
+    std::nth_element(f, m, l);
+  });
+}
+
+template <typename T>
+void benchmark_arithmetic_simd_nth_element(benchmark::State& state) {
+  benchmark_arithmetic_nth_element<T>(state, [](auto f, auto m, auto l) {
+    selection::simd_nth_element(f, m, l);
+  });
+}
+
+void set_arithmetic_sizes(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(kMinArithmeticArraySize,
+                                    kMaxArithmeticArraySize);
+}
+
+void benchmark_stream_exact_top_k(benchmark::State& state) {
+  benchmark_stream(state, [](auto f, auto l) {
+    std::vector<std::int64_t> copy(f, l);
+    std::nth_element(copy.begin(), copy.begin() + kStreamTopK, copy.end(),
+                     std::greater<>{});
+    return copy[kStreamTopK];
+  });
+}
+
+void benchmark_stream_top_k_heap(benchmark::State& state) {
+  benchmark_stream(state, [](auto f, auto l) {
+    selection::top_k_heap<std::int64_t, std::greater<>> top_k(kStreamTopK);
+    top_k.push(f, l);
+    return top_k.size();
+  });
+}
+
+void benchmark_stream_top_k_buffer(benchmark::State& state) {
+  benchmark_stream(state, [](auto f, auto l) {
+    selection::top_k_buffer<std::int64_t, std::greater<>> top_k(kStreamTopK);
+    top_k.push(f, l);
+    return top_k.sorted().size();
+  });
+}
+
+void benchmark_stream_top_k_buffer_sharded(benchmark::State& state) {
+  benchmark_stream(state, [](auto f, auto l) {
+    using top_k_t = selection::top_k_buffer<std::int64_t, std::greater<>>;
+    std::vector<top_k_t> shards(kStreamShards, top_k_t(kStreamTopK));
+    const auto shard_size = std::distance(f, l) / kStreamShards;
+    for (auto& shard : shards) {
+      shard.push(f, f + shard_size);
+      f += shard_size;
+    }
+    shards[0].push(f, l);
+    for (size_t i = 1; i < shards.size(); ++i)
+      shards[0].merge(shards[i]);
+    return shards[0].sorted().size();
+  });
+}
+
+void benchmark_stream_exact_quantile(benchmark::State& state) {
+  benchmark_stream(state, [](auto f, auto l) {
+    std::vector<std::int64_t> copy(f, l);
+    const auto nth = kStreamQuantile * static_cast<double>(copy.size());
+    auto m = copy.begin() + static_cast<std::ptrdiff_t>(nth);
+    std::nth_element(copy.begin(), m, copy.end());
+    return *m;
+  });
+}
+
+void benchmark_stream_kll_quantile(benchmark::State& state) {
+  auto quantile = [](auto f, auto l) {
+    selection::kll_sketch<std::int64_t> sketch;
+    sketch.push(f, l);
+    return sketch.quantile(kStreamQuantile);
+  };
+  benchmark_stream(state, quantile);
+
+  const auto& input = arithmetic_inputs<std::int64_t>(
+      static_cast<size_t>(state.range(0)));
+  report_rank_error(state, quantile(input.begin(), input.end()));
+}
+
+void benchmark_stream_kll_quantile_sharded(benchmark::State& state) {
+  auto quantile = [](auto f, auto l) {
+    std::vector<selection::kll_sketch<std::int64_t>> shards;
+    const auto shard_size = std::distance(f, l) / kStreamShards;
+    for (size_t i = 0; i < kStreamShards; ++i) {
+      shards.emplace_back(200, i);
+      shards.back().push(f, f + shard_size);
+      f += shard_size;
+    }
+    shards[0].push(f, l);
+    for (size_t i = 1; i < shards.size(); ++i)
+      shards[0].merge(shards[i]);
+    return shards[0].quantile(kStreamQuantile);
+  };
+  benchmark_stream(state, quantile);
+
+  const auto& input = arithmetic_inputs<std::int64_t>(
+      static_cast<size_t>(state.range(0)));
+  report_rank_error(state, quantile(input.begin(), input.end()));
+}
+
+// state.range(0) is the size of the input, state.range(1) - number of
+// threads. Only one input and one copy of it are alive at a time, copied
+// into the same memory, see last_inputs.
+template <typename T, typename Inputs>
+void benchmark_parallel_nth_element(benchmark::State& state,
+                                    Inputs inputs_of_size) {
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto threads = static_cast<size_t>(state.range(1));
+  const std::vector<T>& input = inputs_of_size(size);
+  const auto nth = size / (kArraySize / kNthElement);
+  auto& pool = pool_of_size(threads);
+
+  helpers::run_on_copies(state, input,
+                         helpers::input_ring_size(size * sizeof(T)),
+                         [&](std::vector<T>& input_copy) {
+                           selection::parallel_nth_element(
+                               input_copy.begin(), input_copy.begin() + nth,
+                               input_copy.end(), std::less<>{}, pool);
+                         });
+}
+
+void benchmark_parallel_nth_element(benchmark::State& state) {
+  benchmark_parallel_nth_element<value_type>(
+      state, [](size_t size) -> const std::vector<value_type>& {
+        return last_inputs<value_type>(size, make_inputs);
+      });
+}
+
+void benchmark_parallel_nth_element_int64(benchmark::State& state) {
+  benchmark_parallel_nth_element<std::int64_t>(
+      state, [](size_t size) -> const std::vector<std::int64_t>& {
+        return arithmetic_inputs<std::int64_t>(size);
+      });
+}
+
+void add_parallel_args(benchmark::internal::Benchmark* bench,
+                       size_t min_size,
+                       size_t max_size) {
+  const size_t max_threads =
+      std::max<size_t>(1, std::thread::hardware_concurrency());
+  for (size_t size = min_size; size <= max_size; size *= 10) {
+    for (size_t threads = 1; threads < max_threads * 2; threads *= 2) {
+      bench->Args({static_cast<int64_t>(size),
+                   static_cast<int64_t>(std::min(threads, max_threads))});
+    }
+  }
+  bench->ArgNames({"size", "threads"})->UseRealTime();
+}
+
+void set_parallel_args(benchmark::internal::Benchmark* bench) {
+  add_parallel_args(bench, kMinParallelArraySize, kMaxParallelArraySize);
+}
+
+// Takes --parallel_huge out of argv.
+bool parse_parallel_huge(int& argc, char** argv) {
+  bool res = false;
+  int out = 1;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--parallel_huge")
+      res = true;
+    else
+      argv[out++] = argv[i];
+  }
+  argc = out;
+  return res;
+}
+
+void set_stream_sizes(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(kMinStreamSize, kMaxStreamSize);
+}
+
+void set_top_k_ratios(benchmark::internal::Benchmark* bench) {
+  for (int per_mille : {1, 10, 50, 100, 250, 500})
+    bench->Arg(per_mille);
+}
+
+using lexicographic_less_all = comparators::lexicographic_less<
+    comparators::element<0>,
+    comparators::element<1>,
+    comparators::element<2>>;
+
+// inputs() are in [1, 10000], 14 bits per field.
+using packed_less_all = comparators::packed_lexicographic_less<
+    comparators::packed_field<comparators::element<0>, 14>,
+    comparators::packed_field<comparators::element<1>, 14>,
+    comparators::packed_field<comparators::element<2>, 14>>;
+
+void benchmark_compare_all_lexicographic(benchmark::State& state) {
+  benchmark_nth_element_counted<lexicographic_less_all>(
+      state,
+      [](auto f, auto m, auto l, auto p) { std::nth_element(f, m, l, p); });
+}
+
+void benchmark_compare_all_packed(benchmark::State& state) {
+  benchmark_nth_element_counted<packed_less_all>(
+      state,
+      [](auto f, auto m, auto l, auto p) { std::nth_element(f, m, l, p); });
+}
+
+template <typename Compare>
+void benchmark_sort(benchmark::State& state) {
+  benchmark_nth_element_counted<Compare>(
+      state, [](auto f, auto, auto l, auto p) { std::sort(f, l, p); });
+}
+
+// Inserts the second half of inputs() into the sorted first half.
+template <typename Compare>
+void benchmark_bulk_insert(benchmark::State& state) {
+  const auto& input = inputs();
+  auto m = input.begin() + input.size() / 2;
+  std::vector<value_type> already_in(input.begin(), m);
+  std::sort(already_in.begin(), already_in.end());
+
+  helpers::run_on_copies(
+      state, already_in,
+      helpers::input_ring_size(already_in.size() * sizeof(value_type)),
+      [&](std::vector<value_type>& c) {
+        bulk_insert::use_end_buffer_precise(c, m, input.end(), Compare{});
+        benchmark::DoNotOptimize(c.size());
+      });
+}
+
 BENCHMARK(benchmark_empty);
 BENCHMARK(benchmark_only_first);
 BENCHMARK(benchmark_compare_all_default);
 BENCHMARK(benchmark_compare_all_custom);
+BENCHMARK(benchmark_compare_all_lexicographic);
+BENCHMARK(benchmark_compare_all_packed);
+
+BENCHMARK_TEMPLATE(benchmark_sort, std::less<>);
+BENCHMARK_TEMPLATE(benchmark_sort, lexicographic_less_all);
+BENCHMARK_TEMPLATE(benchmark_sort, packed_less_all);
+
+BENCHMARK_TEMPLATE(benchmark_bulk_insert, std::less<>);
+BENCHMARK_TEMPLATE(benchmark_bulk_insert, lexicographic_less_all);
+BENCHMARK_TEMPLATE(benchmark_bulk_insert, packed_less_all);
+
+BENCHMARK(benchmark_top_k_nth_element)->Apply(set_top_k_ratios);
+BENCHMARK(benchmark_top_k_partial_sort)->Apply(set_top_k_ratios);
+BENCHMARK(benchmark_top_k_heap_select)->Apply(set_top_k_ratios);
+BENCHMARK(benchmark_top_k_nth_element_by_key)->Apply(set_top_k_ratios);
+BENCHMARK(benchmark_top_k_partial_sort_by_key)->Apply(set_top_k_ratios);
+
+BENCHMARK_TEMPLATE(benchmark_arithmetic_empty, std::int64_t)
+    ->Apply(set_arithmetic_sizes);
+BENCHMARK_TEMPLATE(benchmark_arithmetic_std_nth_element, std::int64_t)
+    ->Apply(set_arithmetic_sizes);
+BENCHMARK_TEMPLATE(benchmark_arithmetic_simd_nth_element, std::int64_t)
+    ->Apply(set_arithmetic_sizes);
+BENCHMARK_TEMPLATE(benchmark_arithmetic_empty, double)
+    ->Apply(set_arithmetic_sizes);
+BENCHMARK_TEMPLATE(benchmark_arithmetic_std_nth_element, double)
+    ->Apply(set_arithmetic_sizes);
+BENCHMARK_TEMPLATE(benchmark_arithmetic_simd_nth_element, double)
+    ->Apply(set_arithmetic_sizes);
+
+BENCHMARK(benchmark_parallel_nth_element)->Apply(set_parallel_args);
+
+BENCHMARK(benchmark_stream_exact_top_k)->Apply(set_stream_sizes);
+BENCHMARK(benchmark_stream_top_k_heap)->Apply(set_stream_sizes);
+BENCHMARK(benchmark_stream_top_k_buffer)->Apply(set_stream_sizes);
+BENCHMARK(benchmark_stream_top_k_buffer_sharded)->Apply(set_stream_sizes);
+BENCHMARK(benchmark_stream_exact_quantile)->Apply(set_stream_sizes);
+BENCHMARK(benchmark_stream_kll_quantile)->Apply(set_stream_sizes);
+BENCHMARK(benchmark_stream_kll_quantile_sharded)->Apply(set_stream_sizes);
 }
 
-BENCHMARK_MAIN();
+int main(int argc, char** argv) {
+  if (parse_parallel_huge(argc, argv)) {
+    add_parallel_args(
+        benchmark::RegisterBenchmark("benchmark_parallel_nth_element_int64",
+                                     benchmark_parallel_nth_element_int64),
+        kHugeParallelArraySize, kHugeParallelArraySize);
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+}
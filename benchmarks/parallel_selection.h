@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "benchmarks/copy.h"
+#include "benchmarks/thread_pool.h"
+
+namespace helpers {
+
+constexpr std::ptrdiff_t c_parallel_select_min_size = 1 << 16;
+constexpr size_t c_parallel_select_buckets_per_thread = 4;
+constexpr size_t c_parallel_select_oversampling = 32;
+constexpr size_t c_parallel_select_max_buckets = 1 << 16;
+
+// Evenly spaced sample, sorted, every oversampling-th element is a splitter.
+template <typename I, typename P>
+// requires RandomAccessIterator<I> && StrictWeakOrdering<P, ValueType<I>>
+std::vector<ValueType<I>> sample_splitters(I f, I l, size_t buckets, P p) {
+  const size_t sample_size = buckets * c_parallel_select_oversampling;
+  const auto stride =
+      std::distance(f, l) / static_cast<std::ptrdiff_t>(sample_size);
+
+  std::vector<ValueType<I>> sample;
+  sample.reserve(sample_size);
+  for (size_t i = 0; i < sample_size; ++i)
+    sample.push_back(f[static_cast<std::ptrdiff_t>(i) * stride]);
+  std::sort(sample.begin(), sample.end(), p);
+
+  std::vector<ValueType<I>> splitters;
+  splitters.reserve(buckets - 1);
+  for (size_t i = 1; i < buckets; ++i)
+    splitters.push_back(sample[i * c_parallel_select_oversampling]);
+  return splitters;
+}
+
+// Scratch space for partition_into_buckets, for at least as many elements
+// as the first round gets. Allocated once and not initialized: zeroing it
+// would be a serial pass over the whole input.
+template <typename T>
+struct bucket_scratch {
+  explicit bucket_scratch(size_t size)
+      : buffer(new T[size]), bucket_of(new std::uint16_t[size]) {}
+
+  std::unique_ptr<T[]> buffer;
+  std::unique_ptr<std::uint16_t[]> bucket_of;
+};
+
+// One round of sample sort: splits [f, l) into buckets by the splitters and
+// writes them back in order. Returns the bucket boundaries as offsets.
+template <typename I, typename P>
+// requires RandomAccessIterator<I> && StrictWeakOrdering<P, ValueType<I>>
+std::vector<std::ptrdiff_t> partition_into_buckets(
+    I f,
+    I l,
+    const std::vector<ValueType<I>>& splitters,
+    P p,
+    concurrency::thread_pool& pool,
+    bucket_scratch<ValueType<I>>& scratch) {
+  const auto n = std::distance(f, l);
+  const size_t buckets = splitters.size() + 1;
+  const size_t chunks = pool.size();
+  const auto chunk_size =
+      (n + static_cast<std::ptrdiff_t>(chunks) - 1) /
+      static_cast<std::ptrdiff_t>(chunks);
+  auto chunk_begin = [&](size_t chunk) {
+    return std::min(n, static_cast<std::ptrdiff_t>(chunk) * chunk_size);
+  };
+
+  auto* bucket_of = scratch.bucket_of.get();
+  std::vector<std::ptrdiff_t> counts(chunks * buckets);
+
+  pool.parallel_for(chunks, [&](size_t chunk) {
+    auto* chunk_counts = counts.data() + chunk * buckets;
+    for (auto i = chunk_begin(chunk); i < chunk_begin(chunk + 1); ++i) {
+      const auto bucket = std::upper_bound(splitters.begin(), splitters.end(),
+                                           f[i], p) -
+                          splitters.begin();
+      bucket_of[i] = static_cast<std::uint16_t>(bucket);
+      ++chunk_counts[bucket];
+    }
+  });
+
+  // offsets[chunk * buckets + bucket]: where the chunk writes to the bucket.
+  std::vector<std::ptrdiff_t> offsets(chunks * buckets);
+  std::vector<std::ptrdiff_t> bounds(buckets + 1);
+  std::ptrdiff_t total = 0;
+  for (size_t bucket = 0; bucket < buckets; ++bucket) {
+    bounds[bucket] = total;
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+      offsets[chunk * buckets + bucket] = total;
+      total += counts[chunk * buckets + bucket];
+    }
+  }
+  bounds[buckets] = total;
+
+  auto* buffer = scratch.buffer.get();
+  pool.parallel_for(chunks, [&](size_t chunk) {
+    auto* chunk_offsets = offsets.data() + chunk * buckets;
+    for (auto i = chunk_begin(chunk); i < chunk_begin(chunk + 1); ++i) {
+      auto& offset = chunk_offsets[bucket_of[i]];
+      buffer[offset++] = std::move(f[i]);
+    }
+  });
+
+  pool.parallel_for(chunks, [&](size_t chunk) {
+    std::move(buffer + chunk_begin(chunk), buffer + chunk_begin(chunk + 1),
+              f + chunk_begin(chunk));
+  });
+
+  return bounds;
+}
+
+}  // namespace helpers
+
+namespace selection {
+
+// Same contract as std::nth_element. Splits the range into buckets by
+// sampled pivots, counting and scattering chunks in parallel, and then only
+// continues with the bucket that contains m.
+template <typename I, typename P>
+// requires RandomAccessIterator<I> && StrictWeakOrdering<P, ValueType<I>>
+void parallel_nth_element(I f, I m, I l, P p, concurrency::thread_pool& pool) {
+  // Buckets only shrink, the first round's scratch does for all of them.
+  using scratch_type = helpers::bucket_scratch<helpers::ValueType<I>>;
+  std::unique_ptr<scratch_type> scratch;
+  while (true) {
+    const auto n = std::distance(f, l);
+    if (m == l || pool.size() == 1 ||
+        n < helpers::c_parallel_select_min_size) {
+      std::nth_element(f, m, l, p);
+      return;
+    }
+
+    const auto buckets =
+        std::min(pool.size() * helpers::c_parallel_select_buckets_per_thread,
+                 helpers::c_parallel_select_max_buckets);
+    const auto splitters = helpers::sample_splitters(f, l, buckets, p);
+    if (!scratch)
+      scratch = std::make_unique<scratch_type>(static_cast<size_t>(n));
+    const auto bounds =
+        helpers::partition_into_buckets(f, l, splitters, p, pool, *scratch);
+
+    const auto k = std::distance(f, m);
+    const auto bucket =
+        std::upper_bound(bounds.begin(), bounds.end(), k) - bounds.begin() - 1;
+    I bucket_f = f + bounds[static_cast<size_t>(bucket)];
+    I bucket_l = f + bounds[static_cast<size_t>(bucket) + 1];
+
+    // Everything is in one bucket, sampling doesn't help (duplicates).
+    if (bucket_f == f && bucket_l == l) {
+      std::nth_element(f, m, l, p);
+      return;
+    }
+    f = bucket_f;
+    l = bucket_l;
+  }
+}
+
+template <typename I, typename P>
+// requires RandomAccessIterator<I> && StrictWeakOrdering<P, ValueType<I>>
+void parallel_nth_element(I f, I m, I l, P p) {
+  parallel_nth_element(f, m, l, p, concurrency::thread_pool::shared());
+}
+
+template <typename I>
+// requires RandomAccessIterator<I> && TotallyOrdered<ValueType<I>>
+void parallel_nth_element(I f, I m, I l) {
+  parallel_nth_element(f, m, l, std::less<>{});
+}
+
+}  // namespace selection
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace helpers {
+namespace perf {
+
+struct event {
+  const char* name;
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+#ifdef __linux__
+
+constexpr std::uint64_t cache_miss(std::uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+constexpr event c_events[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"l1d_misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_L1D)},
+    {"llc_misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_LL)},
+    {"dtlb_misses", PERF_TYPE_HW_CACHE, cache_miss(PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+// -1 if the event can't be counted here: no PMU in a VM, not supported by
+// the cpu, or perf_event_paranoid is too strict.
+inline int open_event(const event& e) {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = e.type;
+  attr.config = e.config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // More events than hardware counters get multiplexed, these two are
+  // needed to scale the result.
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(
+      ::syscall(__NR_perf_event_open, &attr, 0 /*this thread*/, -1 /*any cpu*/,
+                -1 /*no group*/, 0));
+}
+
+#endif  // __linux__
+
+}  // namespace perf
+
+// Hardware event counts for the calling thread, from perf_event_open.
+// Events that can't be opened are skipped, so on a machine without
+// counters this does nothing and reports nothing.
+//
+//   perf_counters counters;
+//   counters.start();
+//   while (state.KeepRunning()) { ... }
+//   counters.stop();
+//   counters.report(state);
+class perf_counters {
+ public:
+  perf_counters() {
+#ifdef __linux__
+    for (const auto& e : perf::c_events) {
+      const int fd = perf::open_event(e);
+      if (fd >= 0)
+        opened_.push_back({e.name, fd});
+    }
+#endif
+  }
+
+  perf_counters(const perf_counters&) = delete;
+  perf_counters& operator=(const perf_counters&) = delete;
+
+  ~perf_counters() {
+#ifdef __linux__
+    for (const auto& c : opened_)
+      ::close(c.second);
+#endif
+  }
+
+  bool available() const { return !opened_.empty(); }
+
+  // Resets the counts.
+  void start() {
+#ifdef __linux__
+    for (const auto& c : opened_)
+      ::ioctl(c.second, PERF_EVENT_IOC_RESET, 0);
+#endif
+    resume();
+  }
+
+  // Pause and resume go together with state.PauseTiming/ResumeTiming.
+  void pause() {
+#ifdef __linux__
+    for (const auto& c : opened_)
+      ::ioctl(c.second, PERF_EVENT_IOC_DISABLE, 0);
+#endif
+  }
+
+  void resume() {
+#ifdef __linux__
+    for (const auto& c : opened_)
+      ::ioctl(c.second, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  void stop() { pause(); }
+
+  // Event name and count, scaled up if the event was multiplexed. Events
+  // that never got on the hardware are left out.
+  std::vector<std::pair<std::string, double>> read() const {
+    std::vector<std::pair<std::string, double>> res;
+#ifdef __linux__
+    for (const auto& c : opened_) {
+      std::uint64_t values[3];  // value, time enabled, time running
+      if (::read(c.second, values, sizeof(values)) !=
+              static_cast<ssize_t>(sizeof(values)) ||
+          values[2] == 0)
+        continue;
+      res.emplace_back(c.first, static_cast<double>(values[0]) *
+                                    static_cast<double>(values[1]) /
+                                    static_cast<double>(values[2]));
+    }
+#endif
+    return res;
+  }
+
+  // Adds every event as a per iteration counter to a benchmark::State.
+  template <typename State>
+  void report(State& state) const {
+    const auto iterations = static_cast<double>(state.iterations());
+    if (iterations == 0)
+      return;
+    for (const auto& r : read())
+      state.counters[r.first] = r.second / iterations;
+  }
+
+ private:
+  std::vector<std::pair<const char*, int>> opened_;
+};
+
+}  // namespace helpers
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/insert_algorithms.h"
+
+namespace helpers {
+
+constexpr std::uint64_t c_rcu_idle = std::numeric_limits<std::uint64_t>::max();
+
+// Epoch announced by one reader, on its own cache line.
+struct alignas(64) rcu_reader_slot {
+  std::atomic<std::uint64_t> epoch{c_rcu_idle};
+  std::atomic<bool> used{false};
+};
+
+// new[] ignores the alignment of rcu_reader_slot before C++17, so the
+// slots are placed in storage aligned by hand.
+class rcu_reader_slots {
+ public:
+  explicit rcu_reader_slots(size_t size)
+      : size_(size),
+        storage_(new char[(size + 1) * sizeof(rcu_reader_slot)]) {
+    void* aligned = storage_.get();
+    size_t space = (size + 1) * sizeof(rcu_reader_slot);
+    std::align(alignof(rcu_reader_slot), size * sizeof(rcu_reader_slot),
+               aligned, space);
+    slots_ = static_cast<rcu_reader_slot*>(aligned);
+    for (size_t i = 0; i < size_; ++i)
+      new (slots_ + i) rcu_reader_slot;
+  }
+
+  rcu_reader_slots(const rcu_reader_slots&) = delete;
+  rcu_reader_slots& operator=(const rcu_reader_slots&) = delete;
+
+  ~rcu_reader_slots() {
+    for (size_t i = 0; i < size_; ++i)
+      slots_[i].~rcu_reader_slot();
+  }
+
+  rcu_reader_slot& operator[](size_t i) { return slots_[i]; }
+
+ private:
+  size_t size_;
+  std::unique_ptr<char[]> storage_;
+  rcu_reader_slot* slots_;
+};
+
+}  // namespace helpers
+
+namespace concurrency {
+
+// Sorted vector for many readers and one writer at a time. Readers never
+// block: they announce the current epoch and read the published version.
+// The writer builds a new version next to it, publishes it with one atomic
+// store and frees old versions once no reader announced an epoch from
+// before the swap.
+template <typename T, typename P = std::less<>>
+// requires StrictWeakOrdering<P, T>
+class rcu_flat_set {
+ public:
+  using version = std::vector<T>;
+
+  // One per reading thread, claims a slot until destroyed.
+  class reader {
+   public:
+    reader(reader&& x) noexcept : set_(x.set_), slot_(x.slot_) {
+      x.slot_ = nullptr;
+    }
+
+    reader(const reader&) = delete;
+    reader& operator=(const reader&) = delete;
+
+    ~reader() {
+      if (slot_)
+        slot_->used.store(false, std::memory_order_release);
+    }
+
+    // Calls f with the current version, which stays alive during the call.
+    template <typename F>
+    // requires UnaryFunction<F, const version&>
+    decltype(auto) read(F f) {
+      slot_->epoch.store(set_->epoch_.load(std::memory_order_seq_cst),
+                         std::memory_order_seq_cst);
+      const version* v = set_->current_.load(std::memory_order_seq_cst);
+      struct leave_on_exit {
+        ~leave_on_exit() {
+          slot->epoch.store(helpers::c_rcu_idle, std::memory_order_release);
+        }
+        helpers::rcu_reader_slot* slot;
+      } leave{slot_};
+      return f(*v);
+    }
+
+    bool contains(const T& x) {
+      return read([&](const version& v) {
+        auto where = std::lower_bound(v.begin(), v.end(), x, set_->p_);
+        return where != v.end() && !set_->p_(x, *where);
+      });
+    }
+
+   private:
+    friend class rcu_flat_set;
+
+    reader(rcu_flat_set* set, helpers::rcu_reader_slot* slot)
+        : set_(set), slot_(slot) {}
+
+    rcu_flat_set* set_;
+    helpers::rcu_reader_slot* slot_;
+  };
+
+  explicit rcu_flat_set(size_t max_readers, P p = P{})
+      : p_(p),
+        max_readers_(max_readers),
+        slots_(max_readers),
+        current_(new version) {}
+
+  rcu_flat_set(const rcu_flat_set&) = delete;
+  rcu_flat_set& operator=(const rcu_flat_set&) = delete;
+
+  // There must be no readers left.
+  ~rcu_flat_set() {
+    delete current_.load();
+    for (const auto& r : retired_)
+      delete r.first;
+  }
+
+  reader make_reader() {
+    for (size_t i = 0; i < max_readers_; ++i) {
+      bool expected = false;
+      if (slots_[i].used.compare_exchange_strong(expected, true))
+        return reader(this, &slots_[i]);
+    }
+    assert(false && "too many readers");
+    std::terminate();
+  }
+
+  // Writer side, the calls are serialized.
+
+  size_t size() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    return current_.load()->size();
+  }
+
+  template <typename I>
+  // requires ForwardIterator<I>
+  void insert(I f, I l) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    const version* old = current_.load(std::memory_order_relaxed);
+    publish(helpers::reallocate_and_merge_impl(old->begin(), old->end(),
+                                               scratch_, f, l, p_));
+  }
+
+  // Replaces everything, v has to be sorted and unique.
+  void assign(version v) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    publish(std::move(v));
+  }
+
+ private:
+  void publish(version v) {
+    const version* old =
+        current_.exchange(new version(std::move(v)), std::memory_order_seq_cst);
+    const auto retired_epoch =
+        epoch_.fetch_add(1, std::memory_order_seq_cst);
+    retired_.emplace_back(old, retired_epoch);
+    reclaim();
+  }
+
+  // A reader that announced epoch e loaded the version after every swap
+  // that was retired before e.
+  void reclaim() {
+    std::uint64_t oldest_reader = helpers::c_rcu_idle;
+    for (size_t i = 0; i < max_readers_; ++i) {
+      oldest_reader = std::min(
+          oldest_reader, slots_[i].epoch.load(std::memory_order_seq_cst));
+    }
+
+    auto still_used = std::partition(
+        retired_.begin(), retired_.end(),
+        [&](const std::pair<const version*, std::uint64_t>& r) {
+          return r.second < oldest_reader;
+        });
+    for (auto it = retired_.begin(); it != still_used; ++it)
+      delete it->first;
+    retired_.erase(retired_.begin(), still_used);
+  }
+
+  P p_;
+  const size_t max_readers_;
+  helpers::rcu_reader_slots slots_;
+  std::atomic<const version*> current_;
+  std::atomic<std::uint64_t> epoch_{0};
+
+  std::mutex writer_mutex_;
+  std::vector<std::pair<const version*, std::uint64_t>> retired_;
+  version scratch_;
+};
+
+}  // namespace concurrency
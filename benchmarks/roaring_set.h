@@ -0,0 +1,404 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "benchmarks/bit_operations.h"
+
+namespace helpers {
+namespace roaring {
+
+constexpr size_t c_chunk_bits = 16;
+constexpr size_t c_bitmap_words = (size_t(1) << c_chunk_bits) / 64;
+constexpr size_t c_bitmap_bytes = c_bitmap_words * sizeof(std::uint64_t);
+// Above this an array chunk takes more space than a bitmap.
+constexpr size_t c_array_max_size = c_bitmap_bytes / sizeof(std::uint16_t);
+
+enum class chunk_kind { array, bitmap, run };
+
+// [start, last], both included.
+struct run {
+  std::uint16_t start;
+  std::uint16_t last;
+};
+
+// All keys that share the high 16 bits. Only the member for the current kind
+// is used: sorted low halves, a bit per low half or sorted runs of them.
+struct chunk {
+  chunk_kind kind = chunk_kind::array;
+  std::uint32_t size = 0;
+  std::vector<std::uint16_t> array;
+  std::vector<std::uint64_t> bitmap;
+  std::vector<run> runs;
+};
+
+inline size_t popcount(std::uint64_t x) {
+  return static_cast<size_t>(__builtin_popcountll(x));
+}
+
+// Simple loops, so that the compiler can vectorize them (for example with
+// -mpopcnt or -mavx512vpopcntdq).
+inline size_t bitmap_size(const std::uint64_t* words) {
+  size_t res = 0;
+  for (size_t i = 0; i < c_bitmap_words; ++i)
+    res += popcount(words[i]);
+  return res;
+}
+
+// Counts bits that are set while the previous bit is not.
+inline size_t bitmap_run_count(const std::uint64_t* words) {
+  size_t res = 0;
+  std::uint64_t carry = 0;
+  for (size_t i = 0; i < c_bitmap_words; ++i) {
+    const std::uint64_t w = words[i];
+    res += popcount(w & ~((w << 1) | carry));
+    carry = w >> 63;
+  }
+  return res;
+}
+
+inline size_t array_run_count(const std::vector<std::uint16_t>& array) {
+  size_t res = array.empty() ? 0 : 1;
+  for (size_t i = 1; i < array.size(); ++i)
+    res += array[i] != array[i - 1] + 1;
+  return res;
+}
+
+inline size_t run_count(const chunk& c) {
+  switch (c.kind) {
+    case chunk_kind::array:
+      return array_run_count(c.array);
+    case chunk_kind::bitmap:
+      return bitmap_run_count(c.bitmap.data());
+    case chunk_kind::run:
+      return c.runs.size();
+  }
+  return 0;
+}
+
+inline size_t chunk_bytes(const chunk& c) {
+  switch (c.kind) {
+    case chunk_kind::array:
+      return c.array.size() * sizeof(std::uint16_t);
+    case chunk_kind::bitmap:
+      return c_bitmap_bytes;
+    case chunk_kind::run:
+      return c.runs.size() * sizeof(run);
+  }
+  return 0;
+}
+
+inline bool chunk_contains(const chunk& c, std::uint16_t x) {
+  switch (c.kind) {
+    case chunk_kind::array:
+      return std::binary_search(c.array.begin(), c.array.end(), x);
+    case chunk_kind::bitmap:
+      return (c.bitmap[x / 64] >> (x % 64)) & 1;
+    case chunk_kind::run: {
+      auto it = std::upper_bound(
+          c.runs.begin(), c.runs.end(), x,
+          [](std::uint16_t v, const run& r) { return v < r.start; });
+      return it != c.runs.begin() && x <= std::prev(it)->last;
+    }
+  }
+  return false;
+}
+
+// Calls f for every low half in order.
+template <typename F>
+// requires UnaryFunction<F, std::uint16_t>
+void chunk_for_each(const chunk& c, F f) {
+  switch (c.kind) {
+    case chunk_kind::array:
+      std::for_each(c.array.begin(), c.array.end(), f);
+      return;
+    case chunk_kind::bitmap:
+      for (size_t i = 0; i < c_bitmap_words; ++i) {
+        for (std::uint64_t w = c.bitmap[i]; w != 0; w &= w - 1) {
+          f(static_cast<std::uint16_t>(
+              i * 64 + static_cast<size_t>(number_of_trailing_zeros(w))));
+        }
+      }
+      return;
+    case chunk_kind::run:
+      for (const auto& r : c.runs) {
+        for (std::uint32_t x = r.start; x <= r.last; ++x)
+          f(static_cast<std::uint16_t>(x));
+      }
+      return;
+  }
+}
+
+inline std::vector<std::uint16_t> to_array(const chunk& c) {
+  if (c.kind == chunk_kind::array)
+    return c.array;
+  std::vector<std::uint16_t> res;
+  res.reserve(c.size);
+  chunk_for_each(c, [&](std::uint16_t x) { res.push_back(x); });
+  return res;
+}
+
+inline void set_bits(std::vector<std::uint64_t>& bitmap,
+                     const std::uint16_t* f,
+                     const std::uint16_t* l) {
+  for (; f != l; ++f)
+    bitmap[*f / 64] |= std::uint64_t(1) << (*f % 64);
+}
+
+// Rebuilds c as `kind` from sorted low halves.
+inline void assign(chunk& c, chunk_kind kind, std::vector<std::uint16_t> lows) {
+  c.kind = kind;
+  c.size = static_cast<std::uint32_t>(lows.size());
+  c.array.clear();
+  c.bitmap.clear();
+  c.runs.clear();
+  switch (kind) {
+    case chunk_kind::array:
+      c.array = std::move(lows);
+      return;
+    case chunk_kind::bitmap:
+      c.bitmap.assign(c_bitmap_words, 0);
+      set_bits(c.bitmap, lows.data(), lows.data() + lows.size());
+      return;
+    case chunk_kind::run:
+      for (size_t i = 0; i < lows.size(); ++i) {
+        if (i != 0 && lows[i] == lows[i - 1] + 1)
+          c.runs.back().last = lows[i];
+        else
+          c.runs.push_back({lows[i], lows[i]});
+      }
+      return;
+  }
+}
+
+// Switches to the smallest representation.
+inline void optimize(chunk& c) {
+  const size_t run_bytes = run_count(c) * sizeof(run);
+  const size_t array_bytes = c.size * sizeof(std::uint16_t);
+  chunk_kind best = c.size <= c_array_max_size ? chunk_kind::array
+                                               : chunk_kind::bitmap;
+  if (run_bytes < std::min(array_bytes, c_bitmap_bytes))
+    best = chunk_kind::run;
+  if (best != c.kind)
+    assign(c, best, to_array(c));
+}
+
+// Merges sorted and unique low halves [f, l) into sorted runs.
+inline std::vector<run> runs_union(const std::vector<run>& runs,
+                                   const std::uint16_t* f,
+                                   const std::uint16_t* l) {
+  std::vector<run> res;
+  res.reserve(runs.size() + static_cast<size_t>(l - f));
+  auto append = [&](std::uint16_t start, std::uint16_t last) {
+    if (!res.empty() && start <= std::uint32_t(res.back().last) + 1)
+      res.back().last = std::max(res.back().last, last);
+    else
+      res.push_back({start, last});
+  };
+
+  auto it = runs.begin();
+  while (it != runs.end() || f != l) {
+    if (f == l || (it != runs.end() && it->start <= *f)) {
+      append(it->start, it->last);
+      ++it;
+    } else {
+      append(*f, *f);
+      ++f;
+    }
+  }
+  return res;
+}
+
+inline std::uint32_t runs_size(const std::vector<run>& runs) {
+  std::uint32_t res = 0;
+  for (const auto& r : runs)
+    res += std::uint32_t(r.last) - r.start + 1;
+  return res;
+}
+
+// Adds sorted and unique low halves [f, l).
+inline void chunk_add(chunk& c,
+                      const std::uint16_t* f,
+                      const std::uint16_t* l) {
+  if (f == l)
+    return;
+  if (c.kind == chunk_kind::run) {
+    c.runs = runs_union(c.runs, f, l);
+    c.size = runs_size(c.runs);
+  } else if (c.kind == chunk_kind::array &&
+             c.size + static_cast<size_t>(l - f) <= c_array_max_size) {
+    std::vector<std::uint16_t> merged;
+    merged.reserve(c.array.size() + static_cast<size_t>(l - f));
+    std::set_union(c.array.begin(), c.array.end(), f, l,
+                   std::back_inserter(merged));
+    c.array = std::move(merged);
+    c.size = static_cast<std::uint32_t>(c.array.size());
+  } else {
+    if (c.kind != chunk_kind::bitmap)
+      assign(c, chunk_kind::bitmap, to_array(c));
+    set_bits(c.bitmap, f, l);
+    c.size = static_cast<std::uint32_t>(bitmap_size(c.bitmap.data()));
+  }
+  optimize(c);
+}
+
+}  // namespace roaring
+}  // namespace helpers
+
+namespace containers {
+
+// Set of 32 bit integers split by the high 16 bits into chunks. A chunk is a
+// sorted array of the low halves while it's sparse, a 8KB bitmap when it's
+// dense and a list of runs if that's smaller than both. Dense sets take
+// about a bit per possible key instead of 32 bits per key.
+template <typename T>
+class roaring_set {
+  static_assert(std::is_integral<T>::value && sizeof(T) == 4,
+                "only 32 bit keys are supported");
+
+ public:
+  using value_type = T;
+
+  roaring_set() = default;
+
+  template <typename I>
+  // requires ForwardIterator<I>
+  roaring_set(I f, I l) {
+    insert(f, l);
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Chunks plus the index of high halves, not counting allocator slack.
+  size_t memory_bytes() const {
+    size_t res = highs_.size() * (sizeof(std::uint16_t) + sizeof(chunk));
+    for (const auto& c : chunks_)
+      res += helpers::roaring::chunk_bytes(c);
+    return res;
+  }
+
+  bool contains(T x) const {
+    const auto key = to_key(x);
+    auto it = std::lower_bound(highs_.begin(), highs_.end(), high(key));
+    return it != highs_.end() && *it == high(key) &&
+           helpers::roaring::chunk_contains(chunks_[index(it)], low(key));
+  }
+
+  bool insert(T x) {
+    if (contains(x))
+      return false;
+    const auto key = to_key(x);
+    const std::uint16_t l = low(key);
+    helpers::roaring::chunk_add(find_or_add_chunk(high(key)), &l, &l + 1);
+    ++size_;
+    return true;
+  }
+
+  // Union with [f, l), which doesn't have to be sorted.
+  template <typename I>
+  // requires ForwardIterator<I>
+  void insert(I f, I l) {
+    std::vector<std::uint32_t> keys;
+    keys.reserve(static_cast<size_t>(std::distance(f, l)));
+    std::transform(f, l, std::back_inserter(keys), to_key);
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::vector<std::uint16_t> lows;
+    for (auto group_f = keys.begin(); group_f != keys.end();) {
+      const auto h = high(*group_f);
+      auto group_l = std::find_if(group_f, keys.end(), [&](std::uint32_t k) {
+        return high(k) != h;
+      });
+      lows.resize(static_cast<size_t>(group_l - group_f));
+      std::transform(group_f, group_l, lows.begin(), low);
+
+      auto& c = find_or_add_chunk(h);
+      size_ -= c.size;
+      helpers::roaring::chunk_add(c, lows.data(), lows.data() + lows.size());
+      size_ += c.size;
+      group_f = group_l;
+    }
+  }
+
+  // Calls f for every element in order.
+  template <typename F>
+  // requires UnaryFunction<F, T>
+  void for_each(F f) const {
+    for (size_t i = 0; i < highs_.size(); ++i) {
+      const std::uint32_t h = std::uint32_t(highs_[i]) << 16;
+      helpers::roaring::chunk_for_each(
+          chunks_[i], [&](std::uint16_t x) { f(from_key(h | x)); });
+    }
+  }
+
+  // How many chunks of every kind, for tests and benchmark counters.
+  size_t chunk_count(helpers::roaring::chunk_kind kind) const {
+    return static_cast<size_t>(std::count_if(
+        chunks_.begin(), chunks_.end(),
+        [&](const helpers::roaring::chunk& c) { return c.kind == kind; }));
+  }
+
+ private:
+  using chunk = helpers::roaring::chunk;
+
+  // Flipping the sign bit keeps signed keys in order.
+  static constexpr std::uint32_t c_key_flip =
+      std::is_signed<T>::value ? 0x80000000u : 0u;
+
+  static std::uint32_t to_key(T x) {
+    return static_cast<std::uint32_t>(x) ^ c_key_flip;
+  }
+  static T from_key(std::uint32_t key) {
+    return static_cast<T>(key ^ c_key_flip);
+  }
+  static std::uint16_t high(std::uint32_t key) {
+    return static_cast<std::uint16_t>(key >> 16);
+  }
+  static std::uint16_t low(std::uint32_t key) {
+    return static_cast<std::uint16_t>(key);
+  }
+
+  size_t index(std::vector<std::uint16_t>::const_iterator it) const {
+    return static_cast<size_t>(it - highs_.begin());
+  }
+
+  chunk& find_or_add_chunk(std::uint16_t h) {
+    auto it = std::lower_bound(highs_.begin(), highs_.end(), h);
+    const size_t i = index(it);
+    if (it == highs_.end() || *it != h) {
+      highs_.insert(it, h);
+      chunks_.emplace(chunks_.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+    return chunks_[i];
+  }
+
+  std::vector<std::uint16_t> highs_;
+  std::vector<chunk> chunks_;
+  size_t size_ = 0;
+};
+
+template <typename T>
+constexpr std::uint32_t roaring_set<T>::c_key_flip;
+
+}  // namespace containers
+
+namespace bulk_insert {
+
+// Same signature as the algorithms for sorted vectors. Keys are ordered as
+// numbers, so p has to be equivalent to std::less<>.
+template <typename T, typename I, typename P>
+// requires ForwardIterator<I> &&                  //
+//          std::is_same_v<ValueType<I>, T>        //
+void roaring_union(containers::roaring_set<T>& c, I f, I l, P) {
+  c.insert(f, l);
+}
+
+}  // namespace bulk_insert
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/copy.h"
+
+namespace helpers {
+
+template <typename I, typename Proj>
+using ProjectedType =
+    std::decay_t<decltype(std::declval<Proj&>()(*std::declval<I&>()))>;
+
+template <typename I, typename Proj>
+constexpr bool has_arithmetic_key_v =
+    std::is_arithmetic<ProjectedType<I, Proj>>::value;
+
+template <typename P>
+// requires StrictWeakOrdering<P>
+auto compare_first(P p) {
+  return [p](const auto& x, const auto& y) { return p(x.first, y.first); };
+}
+
+template <typename P, typename Proj>
+// requires StrictWeakOrdering<P>
+auto compare_projected(P p, Proj proj) {
+  return [p, proj](const auto& x, const auto& y) {
+    return p(proj(x), proj(y));
+  };
+}
+
+template <typename Index, typename I, typename Proj>
+// requires RandomAccessIterator<I> && UnaryFunction<Proj, ValueType<I>>
+auto extract_keys(I f, I l, Proj proj) {
+  std::vector<std::pair<ProjectedType<I, Proj>, Index>> res;
+  res.reserve(static_cast<size_t>(std::distance(f, l)));
+  Index i = 0;
+  for (; f != l; ++f)
+    res.emplace_back(proj(*f), i++);
+  return res;
+}
+
+// Moves elements with indexes from [kf, kl) to the front of the range starting
+// at f, in the order they are listed. Elements that were at the front are
+// moved into the holes left by the winners, nothing else is touched.
+template <typename I, typename KI>
+// requires RandomAccessIterator<I> &&
+//          ForwardIterator<KI> // ValueType<KI> is (key, index) pair
+void move_to_front_by_index(I f, KI kf, KI kl) {
+  const auto k = static_cast<size_t>(std::distance(kf, kl));
+
+  std::vector<ValueType<I>> winners;
+  winners.reserve(k);
+  std::vector<bool> is_winner_source(k);
+  for (auto it = kf; it != kl; ++it) {
+    const auto index = static_cast<size_t>(it->second);
+    winners.push_back(std::move(f[index]));
+    if (index < k)
+      is_winner_source[index] = true;
+  }
+
+  auto hole = kf;
+  for (size_t i = 0; i < k; ++i) {
+    if (is_winner_source[i])
+      continue;
+    while (static_cast<size_t>(hole->second) < k)
+      ++hole;
+    f[hole->second] = std::move(f[i]);
+    ++hole;
+  }
+
+  std::move(winners.begin(), winners.end(), f);
+}
+
+template <typename Index, typename I, typename Proj, typename P>
+// requires RandomAccessIterator<I> && StrictWeakOrdering<P, ProjectedType<I>>
+void nth_element_extracted_keys(I f, I m, I l, Proj proj, P p) {
+  auto keys = extract_keys<Index>(f, l, proj);
+  auto keys_m = keys.begin() + std::distance(f, m);
+  std::nth_element(keys.begin(), keys_m, keys.end(), compare_first(p));
+  move_to_front_by_index(f, keys.begin(), std::next(keys_m));
+}
+
+template <typename Index, typename I, typename Proj, typename P>
+// requires RandomAccessIterator<I> && StrictWeakOrdering<P, ProjectedType<I>>
+void partial_sort_extracted_keys(I f, I m, I l, Proj proj, P p) {
+  auto keys = extract_keys<Index>(f, l, proj);
+  auto keys_m = keys.begin() + std::distance(f, m);
+  std::partial_sort(keys.begin(), keys_m, keys.end(), compare_first(p));
+  move_to_front_by_index(f, keys.begin(), keys_m);
+}
+
+template <typename I>
+bool fits_in_uint32(I f, I l) {
+  return static_cast<std::uint64_t>(std::distance(f, l)) <=
+         std::numeric_limits<std::uint32_t>::max();
+}
+
+template <typename I, typename Proj, typename P>
+std::enable_if_t<has_arithmetic_key_v<I, Proj>>
+nth_element_by_key_impl(I f, I m, I l, Proj proj, P p) {
+  if (fits_in_uint32(f, l))
+    nth_element_extracted_keys<std::uint32_t>(f, m, l, proj, p);
+  else
+    nth_element_extracted_keys<size_t>(f, m, l, proj, p);
+}
+
+template <typename I, typename Proj, typename P>
+std::enable_if_t<!has_arithmetic_key_v<I, Proj>>
+nth_element_by_key_impl(I f, I m, I l, Proj proj, P p) {
+  std::nth_element(f, m, l, compare_projected(p, proj));
+}
+
+template <typename I, typename Proj, typename P>
+std::enable_if_t<has_arithmetic_key_v<I, Proj>>
+partial_sort_by_key_impl(I f, I m, I l, Proj proj, P p) {
+  if (fits_in_uint32(f, l))
+    partial_sort_extracted_keys<std::uint32_t>(f, m, l, proj, p);
+  else
+    partial_sort_extracted_keys<size_t>(f, m, l, proj, p);
+}
+
+template <typename I, typename Proj, typename P>
+std::enable_if_t<!has_arithmetic_key_v<I, Proj>>
+partial_sort_by_key_impl(I f, I m, I l, Proj proj, P p) {
+  std::partial_sort(f, m, l, compare_projected(p, proj));
+}
+
+}  // namespace helpers
+
+namespace selection {
+
+// Same contract as std::nth_element, ordering by p(proj(x), proj(y)).
+// Arithmetic keys are copied out into a dense (key, index) array, selection
+// runs there and only the winners [f, m] are permuted in the original range.
+template <typename I, typename Proj, typename P>
+// requires RandomAccessIterator<I> && StrictWeakOrdering<P, ProjectedType<I>>
+void nth_element_by_key(I f, I m, I l, Proj proj, P p) {
+  if (m == l)
+    return;
+  helpers::nth_element_by_key_impl(f, m, l, proj, p);
+}
+
+template <typename I, typename Proj>
+// requires RandomAccessIterator<I> && TotallyOrdered<ProjectedType<I>>
+void nth_element_by_key(I f, I m, I l, Proj proj) {
+  nth_element_by_key(f, m, l, proj, std::less<>{});
+}
+
+// Same contract as std::partial_sort, ordering by p(proj(x), proj(y)).
+template <typename I, typename Proj, typename P>
+// requires RandomAccessIterator<I> && StrictWeakOrdering<P, ProjectedType<I>>
+void partial_sort_by_key(I f, I m, I l, Proj proj, P p) {
+  if (f == m)
+    return;
+  helpers::partial_sort_by_key_impl(f, m, l, proj, p);
+}
+
+template <typename I, typename Proj>
+// requires RandomAccessIterator<I> && TotallyOrdered<ProjectedType<I>>
+void partial_sort_by_key(I f, I m, I l, Proj proj) {
+  partial_sort_by_key(f, m, l, proj, std::less<>{});
+}
+
+// Leaves the distance(f, m) smallest elements in [f, m), in heap order.
+template <typename I, typename P>
+// requires RandomAccessIterator<I> && StrictWeakOrdering<P, ValueType<I>>
+void heap_select(I f, I m, I l, P p) {
+  if (f == m)
+    return;
+  std::make_heap(f, m, p);
+  for (I i = m; i != l; ++i) {
+    if (!p(*i, *f))
+      continue;
+    std::pop_heap(f, m, p);
+    std::iter_swap(std::prev(m), i);
+    std::push_heap(f, m, p);
+  }
+}
+
+}  // namespace selection
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/insert_algorithms.h"
+#include "benchmarks/thread_pool.h"
+
+namespace helpers {
+
+// A shard that has this many times the average size triggers a rebalance.
+constexpr size_t c_shard_skew_ratio = 2;
+// Smaller sets are not worth rebalancing.
+constexpr size_t c_min_rebalance_size = 1024;
+
+template <typename T>
+struct flat_shard {
+  std::mutex mutex;
+  std::vector<T> body;
+  std::atomic<size_t> size{0};
+};
+
+}  // namespace helpers
+
+namespace concurrency {
+
+// Sorted set split by key ranges into shard_count flat vectors, each with its
+// own lock. A bulk insert sorts the batch, cuts it at the shard boundaries
+// and merges the pieces into their shards in parallel, so writers only
+// contend when they touch the same shard. When one shard gets much bigger
+// than the average all of them are recut into equal parts.
+template <typename T, typename P = std::less<>>
+// requires StrictWeakOrdering<P, T>
+class sharded_flat_set {
+ public:
+  explicit sharded_flat_set(size_t shard_count,
+                            P p = P{},
+                            thread_pool& pool = thread_pool::shared())
+      : p_(p), pool_(&pool) {
+    for (size_t i = 0; i < std::max<size_t>(shard_count, 1); ++i)
+      shards_.push_back(std::make_unique<helpers::flat_shard<T>>());
+  }
+
+  sharded_flat_set(const sharded_flat_set&) = delete;
+  sharded_flat_set& operator=(const sharded_flat_set&) = delete;
+
+  size_t shard_count() const { return shards_.size(); }
+
+  size_t size() const {
+    size_t res = 0;
+    for (const auto& s : shards_)
+      res += s->size.load(std::memory_order_relaxed);
+    return res;
+  }
+
+  bool contains(const T& x) const {
+    std::shared_lock<std::shared_timed_mutex> layout_lock(layout_mutex_);
+    auto& s = *shards_[shard_index(x)];
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto where = std::lower_bound(s.body.begin(), s.body.end(), x, p_);
+    return where != s.body.end() && !p_(x, *where);
+  }
+
+  template <typename I>
+  // requires ForwardIterator<I>
+  void insert(I f, I l) {
+    std::vector<T> batch(f, l);
+    std::sort(batch.begin(), batch.end(), p_);
+    batch.erase(
+        std::unique(batch.begin(), batch.end(), helpers::not_fn(p_)),
+        batch.end());
+
+    {
+      std::shared_lock<std::shared_timed_mutex> layout_lock(layout_mutex_);
+
+      // Cuts are increasing, so each search starts from the previous one.
+      std::vector<std::pair<size_t, size_t>> pieces;  // shard, cut end
+      size_t cut = 0;
+      for (size_t i = 0; i < boundaries_.size() && cut < batch.size(); ++i) {
+        const auto next = static_cast<size_t>(
+            helpers::lower_bound_biased(batch.begin() + cut, batch.end(),
+                                        boundaries_[i], p_) -
+            batch.begin());
+        if (next != cut)
+          pieces.emplace_back(i, next);
+        cut = next;
+      }
+      if (cut != batch.size())
+        pieces.emplace_back(boundaries_.size(), batch.size());
+
+      pool_->parallel_for(pieces.size(), [&](size_t i) {
+        const size_t piece_f = i == 0 ? 0 : pieces[i - 1].second;
+        auto& s = *shards_[pieces[i].first];
+        std::lock_guard<std::mutex> lock(s.mutex);
+        bulk_insert::use_end_buffer_precise(
+            s.body, std::make_move_iterator(batch.begin() + piece_f),
+            std::make_move_iterator(batch.begin() + pieces[i].second), p_);
+        s.size.store(s.body.size(), std::memory_order_relaxed);
+      });
+    }
+
+    if (skewed())
+      rebalance();
+  }
+
+  // Replaces everything, v has to be sorted and unique.
+  void assign(std::vector<T> v) {
+    std::lock_guard<std::shared_timed_mutex> layout_lock(layout_mutex_);
+    split_evenly(std::move(v));
+  }
+
+  // All elements in order.
+  std::vector<T> flat() const {
+    std::shared_lock<std::shared_timed_mutex> layout_lock(layout_mutex_);
+    std::vector<T> res;
+    for (const auto& s : shards_) {
+      std::lock_guard<std::mutex> lock(s->mutex);
+      res.insert(res.end(), s->body.begin(), s->body.end());
+    }
+    return res;
+  }
+
+  void rebalance() {
+    std::lock_guard<std::shared_timed_mutex> layout_lock(layout_mutex_);
+    // Someone else could have rebalanced while we were waiting.
+    if (!skewed())
+      return;
+    std::vector<T> all;
+    all.reserve(size());
+    for (auto& s : shards_) {
+      all.insert(all.end(), std::make_move_iterator(s->body.begin()),
+                 std::make_move_iterator(s->body.end()));
+    }
+    split_evenly(std::move(all));
+  }
+
+ private:
+  // Shard i holds [boundaries_[i - 1], boundaries_[i]). Until the first
+  // rebalance there are no boundaries and everything goes into shard 0.
+  size_t shard_index(const T& x) const {
+    return static_cast<size_t>(
+        std::upper_bound(boundaries_.begin(), boundaries_.end(), x, p_) -
+        boundaries_.begin());
+  }
+
+  bool skewed() const {
+    const size_t total = size();
+    if (total < helpers::c_min_rebalance_size)
+      return false;
+    const size_t limit = helpers::c_shard_skew_ratio * total / shards_.size();
+    return std::any_of(shards_.begin(), shards_.end(), [&](const auto& s) {
+      return s->size.load(std::memory_order_relaxed) > limit;
+    });
+  }
+
+  // Expects the layout to be locked exclusively.
+  void split_evenly(std::vector<T> all) {
+    boundaries_.clear();
+    const size_t n = shards_.size();
+    for (size_t i = 0; i < n; ++i) {
+      const size_t f = all.size() * i / n;
+      const size_t l = all.size() * (i + 1) / n;
+      if (i != 0 && f != all.size())
+        boundaries_.push_back(all[f]);
+      auto& s = *shards_[i];
+      s.body.assign(std::make_move_iterator(all.begin() + f),
+                    std::make_move_iterator(all.begin() + l));
+      s.size.store(s.body.size(), std::memory_order_relaxed);
+    }
+  }
+
+  P p_;
+  thread_pool* pool_;
+  mutable std::shared_timed_mutex layout_mutex_;
+  std::vector<T> boundaries_;
+  std::vector<std::unique_ptr<helpers::flat_shard<T>>> shards_;
+};
+
+}  // namespace concurrency
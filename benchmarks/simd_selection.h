@@ -0,0 +1,381 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BENCHMARKS_HAS_AVX2_SELECTION 1
+#include <immintrin.h>
+#endif
+
+#include "benchmarks/bit_operations.h"
+
+namespace helpers {
+namespace simd {
+
+// Moves elements that are less than pivot (or less or equal, if OrEqual)
+// to the front. Returns the partition point.
+template <bool OrEqual, typename T>
+T* scalar_partition(T* f, T* l, T pivot) {
+  return std::partition(f, l, [pivot](T x) {
+    return OrEqual ? !(pivot < x) : x < pivot;
+  });
+}
+
+struct scalar_partitioner {
+  template <bool OrEqual, typename T>
+  static T* partition(T* f, T* l, T pivot) {
+    return scalar_partition<OrEqual>(f, l, pivot);
+  }
+};
+
+#ifdef BENCHMARKS_HAS_AVX2_SELECTION
+
+#define BENCHMARKS_AVX2 __attribute__((target("avx2,popcnt")))
+
+// For every 4 bit mask: 32 bit lane indexes that put 64 bit lanes with the
+// bit set first (in order) and the rest after them.
+struct compress_table_t {
+  alignas(32) std::int32_t idx[16][8];
+};
+
+inline const compress_table_t& compress_table() {
+  static const compress_table_t table = [] {
+    compress_table_t res;
+    for (int mask = 0; mask < 16; ++mask) {
+      int out = 0;
+      for (int selected = 1; selected >= 0; --selected) {
+        for (int lane = 0; lane < 4; ++lane) {
+          if (((mask >> lane) & 1) != selected)
+            continue;
+          res.idx[mask][out++] = 2 * lane;
+          res.idx[mask][out++] = 2 * lane + 1;
+        }
+      }
+    }
+    return res;
+  }();
+  return table;
+}
+
+template <typename T>
+struct avx2_lanes;
+
+template <>
+struct avx2_lanes<std::int64_t> {
+  using reg = __m256i;
+
+  BENCHMARKS_AVX2 static reg load(const std::int64_t* p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+  }
+
+  BENCHMARKS_AVX2 static void store(std::int64_t* p, reg v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+  }
+
+  BENCHMARKS_AVX2 static reg broadcast(std::int64_t x) {
+    return _mm256_set1_epi64x(x);
+  }
+
+  template <bool OrEqual>
+  BENCHMARKS_AVX2 static int goes_left(reg v, reg pivot) {
+    if (OrEqual) {
+      reg greater = _mm256_cmpgt_epi64(v, pivot);
+      return ~_mm256_movemask_pd(_mm256_castsi256_pd(greater)) & 0xF;
+    }
+    reg less = _mm256_cmpgt_epi64(pivot, v);
+    return _mm256_movemask_pd(_mm256_castsi256_pd(less));
+  }
+
+  BENCHMARKS_AVX2 static reg permute(reg v, __m256i idx) {
+    return _mm256_permutevar8x32_epi32(v, idx);
+  }
+};
+
+template <>
+struct avx2_lanes<double> {
+  using reg = __m256d;
+
+  BENCHMARKS_AVX2 static reg load(const double* p) {
+    return _mm256_loadu_pd(p);
+  }
+
+  BENCHMARKS_AVX2 static void store(double* p, reg v) {
+    _mm256_storeu_pd(p, v);
+  }
+
+  BENCHMARKS_AVX2 static reg broadcast(double x) {
+    return _mm256_set1_pd(x);
+  }
+
+  template <bool OrEqual>
+  BENCHMARKS_AVX2 static int goes_left(reg v, reg pivot) {
+    if (OrEqual)
+      return _mm256_movemask_pd(_mm256_cmp_pd(v, pivot, _CMP_LE_OQ));
+    return _mm256_movemask_pd(_mm256_cmp_pd(v, pivot, _CMP_LT_OQ));
+  }
+
+  BENCHMARKS_AVX2 static reg permute(reg v, __m256i idx) {
+    return _mm256_castsi256_pd(
+        _mm256_permutevar8x32_epi32(_mm256_castpd_si256(v), idx));
+  }
+};
+
+// Compress-stores one register: the left part goes to write_l, the right
+// part ends at write_r. Both stores are full width, the caller guarantees
+// there is a free register worth of space on both sides.
+template <bool OrEqual, typename T>
+BENCHMARKS_AVX2 void avx2_partition_register(
+    typename avx2_lanes<T>::reg v,
+    typename avx2_lanes<T>::reg pivot,
+    const compress_table_t& table,
+    T*& write_l,
+    T*& write_r) {
+  using lanes = avx2_lanes<T>;
+  const int mask = lanes::template goes_left<OrEqual>(v, pivot);
+  const auto idx =
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(table.idx[mask]));
+  v = lanes::permute(v, idx);
+  const int n_left = _mm_popcnt_u32(static_cast<unsigned>(mask));
+  lanes::store(write_l, v);
+  lanes::store(write_r - 4, v);
+  write_l += n_left;
+  write_r -= 4 - n_left;
+}
+
+// In place vectorized partition: the first and the last registers are kept
+// aside, which leaves enough free space to always compress-store both ways.
+// Each step reads from the side with less free space.
+template <bool OrEqual, typename T>
+BENCHMARKS_AVX2 T* avx2_partition(T* f, T* l, T pivot) {
+  using lanes = avx2_lanes<T>;
+  constexpr std::ptrdiff_t width = 4;
+
+  if (l - f < 2 * width)
+    return scalar_partition<OrEqual>(f, l, pivot);
+
+  const auto& table = compress_table();
+  const auto vpivot = lanes::broadcast(pivot);
+  const auto first_register = lanes::load(f);
+  const auto last_register = lanes::load(l - width);
+
+  T* read_l = f + width;
+  T* read_r = l - width;
+  T* write_l = f;
+  T* write_r = l;
+
+  while (read_r - read_l >= width) {
+    typename lanes::reg v;
+    if (read_l - write_l <= write_r - read_r) {
+      v = lanes::load(read_l);
+      read_l += width;
+    } else {
+      read_r -= width;
+      v = lanes::load(read_r);
+    }
+    avx2_partition_register<OrEqual>(v, vpivot, table, write_l, write_r);
+  }
+
+  T tail[width];
+  T* tail_l = std::copy(read_l, read_r, tail);
+  for (T* it = tail; it != tail_l; ++it) {
+    if (OrEqual ? !(pivot < *it) : *it < pivot)
+      *write_l++ = *it;
+    else
+      *--write_r = *it;
+  }
+
+  avx2_partition_register<OrEqual>(first_register, vpivot, table, write_l,
+                                   write_r);
+
+  // Exactly one register of space is left.
+  const int mask = lanes::template goes_left<OrEqual>(last_register, vpivot);
+  const auto idx =
+      _mm256_load_si256(reinterpret_cast<const __m256i*>(table.idx[mask]));
+  lanes::store(write_l, lanes::permute(last_register, idx));
+  return write_l + _mm_popcnt_u32(static_cast<unsigned>(mask));
+}
+
+struct avx2_partitioner {
+  template <bool OrEqual, typename T>
+  static T* partition(T* f, T* l, T pivot) {
+    return avx2_partition<OrEqual>(f, l, pivot);
+  }
+};
+
+#undef BENCHMARKS_AVX2
+
+inline bool has_avx2() {
+  static const bool res = __builtin_cpu_supports("avx2") &&
+                          __builtin_cpu_supports("popcnt");
+  return res;
+}
+
+#else
+
+inline bool has_avx2() {
+  return false;
+}
+
+#endif  // BENCHMARKS_HAS_AVX2_SELECTION
+
+constexpr std::ptrdiff_t c_small_select_size = 64;
+constexpr std::ptrdiff_t c_floyd_rivest_min_size = 600;
+
+template <typename T>
+T median_of_3(T a, T b, T c) {
+  return std::max(std::min(a, b), std::min(std::max(a, b), c));
+}
+
+template <typename Partitioner, typename T>
+void introselect(T* f, T* m, T* l);
+
+template <typename Partitioner, typename T>
+T median_of_medians(T* f, T* l) {
+  std::vector<T> medians;
+  medians.reserve(static_cast<size_t>((l - f) / 5 + 1));
+  while (f != l) {
+    T* next = f + std::min<std::ptrdiff_t>(5, l - f);
+    T group[5];
+    T* group_l = std::copy(f, next, group);
+    f = next;
+    T* group_m = group + (group_l - group - 1) / 2;
+    std::nth_element(group, group_m, group_l);
+    medians.push_back(*group_m);
+  }
+  T* medians_m = medians.data() + medians.size() / 2;
+  introselect<Partitioner>(medians.data(), medians_m,
+                           medians.data() + medians.size());
+  return *medians_m;
+}
+
+// Floyd-Rivest: picks two pivots from an evenly spaced sample, so that the
+// nth element ends up between them with high probability and the middle part
+// is small.
+template <typename T>
+std::pair<T, T> floyd_rivest_pivots(const T* f, const T* m, const T* l) {
+  const auto n = static_cast<double>(l - f);
+  const auto sample_size = static_cast<std::ptrdiff_t>(
+      0.5 * std::exp(2.0 * std::log(n) / 3.0));
+  const auto stride = (l - f) / sample_size;
+
+  std::vector<T> sample(static_cast<size_t>(sample_size));
+  for (std::ptrdiff_t i = 0; i < sample_size; ++i)
+    sample[static_cast<size_t>(i)] = f[i * stride];
+
+  const auto rank = static_cast<std::ptrdiff_t>(
+      static_cast<double>(m - f) * static_cast<double>(sample_size) / n);
+  const auto delta = static_cast<std::ptrdiff_t>(
+      0.5 * std::sqrt(std::log(n) * static_cast<double>(sample_size))) + 1;
+
+  auto lo = sample.begin() + std::max<std::ptrdiff_t>(0, rank - delta);
+  auto hi = sample.begin() +
+            std::min<std::ptrdiff_t>(sample_size - 1, rank + delta);
+  std::nth_element(sample.begin(), lo, sample.end());
+  std::nth_element(lo, hi, sample.end());
+  return {*lo, *hi};
+}
+
+// Three way step around a pivot that is an element of [f, l).
+// Always shrinks the range; returns true if the nth element is in place.
+template <typename Partitioner, typename T>
+bool select_step(T*& f, T* m, T*& l, T pivot) {
+  T* less_l = Partitioner::template partition<false>(f, l, pivot);
+  if (m < less_l) {
+    l = less_l;
+    return false;
+  }
+  if (less_l != f) {
+    f = less_l;
+    return false;
+  }
+  T* equal_l = Partitioner::template partition<true>(f, l, pivot);
+  if (m < equal_l)
+    return true;
+  f = equal_l;
+  return false;
+}
+
+// Introselect: Floyd-Rivest pivots for big ranges, median of 3 for the rest,
+// median of medians once the partitions stop making progress.
+template <typename Partitioner, typename T>
+void introselect(T* f, T* m, T* l) {
+  if (m == l)
+    return;
+
+  auto budget = 2 * first_significant_bit_pos(l - f) + 4;
+
+  while (l - f > c_small_select_size) {
+    if (--budget < 0) {
+      if (select_step<Partitioner>(f, m, l,
+                                   median_of_medians<Partitioner>(f, l)))
+        return;
+      continue;
+    }
+
+    if (l - f < c_floyd_rivest_min_size) {
+      T pivot = median_of_3(*f, f[(l - f) / 2], *(l - 1));
+      if (select_step<Partitioner>(f, m, l, pivot))
+        return;
+      continue;
+    }
+
+    auto pivots = floyd_rivest_pivots(f, m, l);
+    T* less_l = Partitioner::template partition<false>(f, l, pivots.first);
+    if (m < less_l) {
+      l = less_l;
+      continue;
+    }
+    f = less_l;
+    T* middle_l = Partitioner::template partition<true>(f, l, pivots.second);
+    if (m < middle_l) {
+      l = middle_l;
+      if (!(pivots.first < pivots.second))
+        return;  // Everything in [f, l) is equal.
+    } else {
+      f = middle_l;
+    }
+  }
+
+  std::nth_element(f, m, l);
+}
+
+template <typename T>
+constexpr bool is_simd_selectable_v =
+    std::is_same<T, std::int64_t>::value || std::is_same<T, double>::value;
+
+}  // namespace simd
+}  // namespace helpers
+
+namespace selection {
+
+// Same contract as std::nth_element with std::less, for contiguous arrays of
+// int64_t and double. Uses AVX2 partitioning when the CPU supports it.
+template <typename T>
+// requires helpers::simd::is_simd_selectable_v<T>
+void simd_nth_element(T* f, T* m, T* l) {
+  static_assert(helpers::simd::is_simd_selectable_v<T>, "");
+#ifdef BENCHMARKS_HAS_AVX2_SELECTION
+  if (helpers::simd::has_avx2()) {
+    helpers::simd::introselect<helpers::simd::avx2_partitioner>(f, m, l);
+    return;
+  }
+#endif
+  helpers::simd::introselect<helpers::simd::scalar_partitioner>(f, m, l);
+}
+
+template <typename I>
+// requires ContiguousIterator<I>
+void simd_nth_element(I f, I m, I l) {
+  if (f == l)
+    return;
+  auto* data = &*f;
+  simd_nth_element(data, data + (m - f), data + (l - f));
+}
+
+}  // namespace selection
@@ -2,18 +2,37 @@
 #include <numeric>
 #include <iostream>
 
+#include "benchmarks/allocation_tracking.h"
 #include "benchmarks/insert_algorithms.h"
+#include "benchmarks/instrumented.h"
+#include "benchmarks/perf_counters.h"
 
-#include "third_party/benchmark/include/benchmark/benchmark.h"
+#include "benchmark/benchmark.h"
 
 template <typename Searcher>
 void searcher_benchmark(benchmark::State& state, Searcher searcher) {
   std::vector<int> input(1000u);
   std::iota(input.begin(), input.end(), 0);
   int looking_for = state.range(0);
+  helpers::allocation_tracker allocations;
+  helpers::perf_counters counters;
+  counters.start();
   while (state.KeepRunning()) {
     benchmark::DoNotOptimize(searcher(input.begin(), input.end(), looking_for));
   }
+  counters.stop();
+  counters.report(state);
+  allocations.report(state);
+
+  std::vector<helpers::instrumented<int>> instrumented_input;
+  for (int x : input)
+    instrumented_input.emplace_back(x);
+  const helpers::instrumented<int> instrumented_looking_for(looking_for);
+  helpers::operation_counter operations;
+  benchmark::DoNotOptimize(searcher(instrumented_input.begin(),
+                                    instrumented_input.end(),
+                                    instrumented_looking_for));
+  operations.report(state);
 }
 
 void lower_bound_linear(benchmark::State& state) {
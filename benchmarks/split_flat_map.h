@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "benchmarks/insert_algorithms.h"
+
+namespace containers {
+
+// Sorted map that keeps keys and values in two parallel vectors, so that
+// searching only touches keys. Values are addressed by the key's index.
+template <typename K, typename V, typename P = std::less<>>
+// requires StrictWeakOrdering<P, K>
+class split_flat_map {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+
+  split_flat_map() = default;
+  explicit split_flat_map(P p) : p_(p) {}
+
+  size_t size() const { return keys_.size(); }
+  bool empty() const { return keys_.empty(); }
+
+  const std::vector<K>& keys() const { return keys_; }
+  const std::vector<V>& values() const { return values_; }
+  std::vector<V>& values() { return values_; }
+
+  size_t lower_bound_index(const K& key) const {
+    return static_cast<size_t>(
+        std::lower_bound(keys_.begin(), keys_.end(), key, p_) - keys_.begin());
+  }
+
+  // nullptr if there is no such key.
+  const V* find(const K& key) const {
+    const auto i = lower_bound_index(key);
+    if (i == keys_.size() || p_(key, keys_[i]))
+      return nullptr;
+    return &values_[i];
+  }
+
+  V* find(const K& key) {
+    return const_cast<V*>(static_cast<const split_flat_map&>(*this).find(key));
+  }
+
+  bool contains(const K& key) const { return find(key) != nullptr; }
+
+  // Does nothing if the key is already there, like std::map::try_emplace.
+  template <typename... Args>
+  std::pair<V*, bool> emplace(K key, Args&&... args) {
+    const auto i = lower_bound_index(key);
+    if (i != keys_.size() && !p_(key, keys_[i]))
+      return {&values_[i], false};
+    keys_.insert(keys_.begin() + i, std::move(key));
+    values_.emplace(values_.begin() + i, std::forward<Args>(args)...);
+    return {&values_[i], true};
+  }
+
+  // [f, l) are (key, value) pairs. For equal keys the value that is already
+  // in the map wins, then the first one in [f, l).
+  template <typename I>
+  // requires ForwardIterator<I>
+  void insert(I f, I l) {
+    std::vector<std::pair<K, V>> new_elements(f, l);
+    insert_sorted_unique(std::move(new_elements));
+  }
+
+ private:
+  // A key and where its value comes from: values_ below the original size,
+  // the new elements above.
+  struct entry {
+    K key;
+    size_t from;
+  };
+
+  // Merges the keys with the bulk_insert algorithm, as a key/index
+  // permutation, then moves the values into place by it.
+  void insert_sorted_unique(std::vector<std::pair<K, V>> new_elements) {
+    auto key_less = [this](const auto& x, const auto& y) {
+      return p_(x.first, y.first);
+    };
+    std::stable_sort(new_elements.begin(), new_elements.end(), key_less);
+    new_elements.erase(std::unique(new_elements.begin(), new_elements.end(),
+                                   helpers::not_fn(key_less)),
+                       new_elements.end());
+
+    const auto orig_len = keys_.size();
+    std::vector<entry> merged;
+    merged.reserve(orig_len + new_elements.size());
+    for (size_t i = 0; i < orig_len; ++i)
+      merged.push_back({std::move(keys_[i]), i});
+    std::vector<entry> inserting;
+    inserting.reserve(new_elements.size());
+    for (size_t i = 0; i < new_elements.size(); ++i)
+      inserting.push_back({std::move(new_elements[i].first), orig_len + i});
+
+    // Already unique, so its own sort and unique keep them as they are.
+    // For equal keys the original wins.
+    bulk_insert::use_end_buffer_precise(
+        merged, std::make_move_iterator(inserting.begin()),
+        std::make_move_iterator(inserting.end()),
+        [this](const entry& x, const entry& y) { return p_(x.key, y.key); });
+
+    // From the back: an original value only moves right, so it is read
+    // before its slot is written.
+    values_.resize(merged.size());
+    for (size_t i = merged.size(); i-- != 0;) {
+      const auto from = merged[i].from;
+      if (from < orig_len) {
+        if (from != i)
+          values_[i] = std::move(values_[from]);
+        continue;
+      }
+      values_[i] = std::move(new_elements[from - orig_len].second);
+    }
+
+    keys_.resize(merged.size());
+    for (size_t i = 0; i < merged.size(); ++i)
+      keys_[i] = std::move(merged[i].key);
+  }
+
+  P p_;
+  std::vector<K> keys_;
+  std::vector<V> values_;
+};
+
+}  // namespace containers
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace selection {
+
+// Keeps the k smallest (by P) elements seen so far in a bounded max heap.
+template <typename T, typename P = std::less<>>
+// requires StrictWeakOrdering<P, T>
+class top_k_heap {
+ public:
+  explicit top_k_heap(size_t k, P p = P{}) : k_(k), p_(p) { heap_.reserve(k); }
+
+  void push(const T& x) {
+    if (heap_.size() < k_) {
+      heap_.push_back(x);
+      std::push_heap(heap_.begin(), heap_.end(), p_);
+      return;
+    }
+    if (k_ == 0 || !p_(x, heap_.front()))
+      return;
+    std::pop_heap(heap_.begin(), heap_.end(), p_);
+    heap_.back() = x;
+    std::push_heap(heap_.begin(), heap_.end(), p_);
+  }
+
+  template <typename I>
+  // requires InputIterator<I>
+  void push(I f, I l) {
+    for (; f != l; ++f)
+      push(*f);
+  }
+
+  void merge(const top_k_heap& other) {
+    push(other.heap_.begin(), other.heap_.end());
+  }
+
+  std::vector<T> sorted() const {
+    auto res = heap_;
+    std::sort_heap(res.begin(), res.end(), p_);
+    return res;
+  }
+
+  size_t k() const { return k_; }
+  size_t size() const { return heap_.size(); }
+
+ private:
+  size_t k_;
+  P p_;
+  std::vector<T> heap_;
+};
+
+// Keeps the k smallest (by P) elements seen so far. New elements are appended
+// to a buffer that is pruned back to k with nth_element once it holds
+// k + batch elements. After the first prune everything that is not better
+// than the current k-th element is rejected with one comparison.
+template <typename T, typename P = std::less<>>
+// requires StrictWeakOrdering<P, T>
+class top_k_buffer {
+ public:
+  explicit top_k_buffer(size_t k, P p = P{}) : top_k_buffer(k, k, p) {}
+
+  top_k_buffer(size_t k, size_t batch, P p = P{})
+      : k_(k), batch_(std::max<size_t>(batch, 1)), p_(p) {
+    buffer_.reserve(k_ + batch_);
+  }
+
+  void push(const T& x) {
+    if (k_ == 0 || (has_threshold_ && !p_(x, threshold_)))
+      return;
+    buffer_.push_back(x);
+    if (buffer_.size() >= k_ + batch_)
+      prune();
+  }
+
+  template <typename I>
+  // requires InputIterator<I>
+  void push(I f, I l) {
+    for (; f != l; ++f)
+      push(*f);
+  }
+
+  void merge(const top_k_buffer& other) {
+    push(other.buffer_.begin(), other.buffer_.end());
+  }
+
+  std::vector<T> sorted() const {
+    auto res = buffer_;
+    auto m = res.begin() + std::min(res.size(), k_);
+    std::partial_sort(res.begin(), m, res.end(), p_);
+    res.erase(m, res.end());
+    return res;
+  }
+
+  size_t k() const { return k_; }
+
+ private:
+  void prune() {
+    auto kth = buffer_.begin() + (k_ - 1);
+    std::nth_element(buffer_.begin(), kth, buffer_.end(), p_);
+    buffer_.erase(std::next(kth), buffer_.end());
+    threshold_ = *kth;
+    has_threshold_ = true;
+  }
+
+  size_t k_;
+  size_t batch_;
+  P p_;
+  std::vector<T> buffer_;
+  T threshold_{};
+  bool has_threshold_ = false;
+};
+
+constexpr size_t c_kll_min_capacity = 8;
+
+// KLL quantile sketch (Karnin, Lang, Liberty). Level h keeps a compactor of
+// items with weight 2^h; capacities shrink by 2/3 towards the lower levels.
+// A full compactor is sorted and every other item is promoted, starting
+// from a random offset.
+template <typename T, typename P = std::less<>>
+// requires StrictWeakOrdering<P, T>
+class kll_sketch {
+ public:
+  explicit kll_sketch(size_t k = 200, std::uint64_t seed = 0, P p = P{})
+      : k_(std::max(k, c_kll_min_capacity)), p_(p), random_(seed), levels_(1) {
+    update_capacities();
+  }
+
+  void push(const T& x) {
+    levels_[0].push_back(x);
+    ++count_;
+    ++retained_;
+    if (retained_ > total_capacity_)
+      compress();
+  }
+
+  template <typename I>
+  // requires InputIterator<I>
+  void push(I f, I l) {
+    for (; f != l; ++f)
+      push(*f);
+  }
+
+  void merge(const kll_sketch& other) {
+    if (levels_.size() < other.levels_.size()) {
+      levels_.resize(other.levels_.size());
+      update_capacities();
+    }
+    for (size_t h = 0; h < other.levels_.size(); ++h) {
+      levels_[h].insert(levels_[h].end(), other.levels_[h].begin(),
+                        other.levels_[h].end());
+    }
+    count_ += other.count_;
+    retained_ += other.retained_;
+    while (retained_ > total_capacity_)
+      compress();
+  }
+
+  // q is in [0, 1]. Undefined for an empty sketch.
+  T quantile(double q) const {
+    std::vector<std::pair<T, std::uint64_t>> weighted;
+    weighted.reserve(retained_);
+    for (size_t h = 0; h < levels_.size(); ++h) {
+      for (const auto& x : levels_[h])
+        weighted.emplace_back(x, std::uint64_t(1) << h);
+    }
+    std::sort(weighted.begin(), weighted.end(),
+              [this](const auto& x, const auto& y) {
+                return p_(x.first, y.first);
+              });
+
+    const auto target = q * static_cast<double>(count_);
+    std::uint64_t seen = 0;
+    for (const auto& x : weighted) {
+      seen += x.second;
+      if (static_cast<double>(seen) > target)
+        return x.first;
+    }
+    return weighted.back().first;
+  }
+
+  std::uint64_t count() const { return count_; }
+  size_t retained() const { return retained_; }
+
+ private:
+  // Capacities only depend on the number of levels, so they are recomputed
+  // when a level is added.
+  void update_capacities() {
+    capacities_.resize(levels_.size());
+    total_capacity_ = 0;
+    for (size_t h = 0; h < levels_.size(); ++h) {
+      const auto depth = static_cast<double>(levels_.size() - h - 1);
+      const auto capacity =
+          std::ceil(static_cast<double>(k_) * std::pow(2.0 / 3.0, depth));
+      capacities_[h] =
+          std::max(c_kll_min_capacity, static_cast<size_t>(capacity));
+      total_capacity_ += capacities_[h];
+    }
+  }
+
+  void compress() {
+    for (size_t h = 0; h < levels_.size(); ++h) {
+      if (levels_[h].size() < capacities_[h])
+        continue;
+      if (h + 1 == levels_.size()) {
+        levels_.emplace_back();
+        update_capacities();
+      }
+      compact(h);
+      return;
+    }
+  }
+
+  void compact(size_t h) {
+    auto& level = levels_[h];
+    auto& next = levels_[h + 1];
+    std::sort(level.begin(), level.end(), p_);
+
+    // An odd item stays on this level.
+    const size_t leftover = level.size() & 1;
+    size_t i = leftover + static_cast<size_t>(random_() & 1);
+    const auto promoted = (level.size() - leftover) / 2;
+    for (; i < level.size(); i += 2)
+      next.push_back(level[i]);
+    level.resize(leftover);
+    retained_ -= promoted;
+  }
+
+  size_t k_;
+  P p_;
+  std::mt19937_64 random_;
+  std::vector<std::vector<T>> levels_;
+  std::uint64_t count_ = 0;
+  size_t retained_ = 0;
+  std::vector<size_t> capacities_;
+  size_t total_capacity_ = 0;
+};
+
+}  // namespace selection
@@ -0,0 +1,496 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "benchmarks/bit_operations.h"
+
+namespace helpers {
+namespace swiss {
+
+// Control byte per slot: empty, deleted or the 7 low bits of the hash.
+using ctrl_t = std::int8_t;
+
+constexpr ctrl_t c_empty = -128;
+constexpr ctrl_t c_deleted = -2;
+constexpr size_t c_group_size = 16;
+constexpr size_t c_min_capacity = c_group_size;
+
+inline bool is_full(ctrl_t c) {
+  return c >= 0;
+}
+
+// Pointers and integers often hash to themselves, with all the entropy in the
+// middle bits. Multiplying and folding spreads it over both h1 and h2.
+inline std::uint64_t mix(std::uint64_t h) {
+  const auto m =
+      static_cast<unsigned __int128>(h) * 0x9E3779B97F4A7C15ull;
+  return static_cast<std::uint64_t>(m) ^ static_cast<std::uint64_t>(m >> 64);
+}
+
+inline size_t h1(std::uint64_t hash) {
+  return static_cast<size_t>(hash >> 7);
+}
+
+inline ctrl_t h2(std::uint64_t hash) {
+  return static_cast<ctrl_t>(hash & 0x7F);
+}
+
+// 16 control bytes. Matches are returned as bitmasks, bit i for byte i.
+#ifdef __SSE2__
+
+class group {
+ public:
+  explicit group(const ctrl_t* p)
+      : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+  unsigned match(ctrl_t h) const {
+    return mask(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(h)));
+  }
+
+  unsigned match_empty() const { return match(c_empty); }
+
+  // Both empty and deleted are negative and less than -1.
+  unsigned match_empty_or_deleted() const {
+    return mask(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl_));
+  }
+
+ private:
+  static unsigned mask(__m128i x) {
+    return static_cast<unsigned>(_mm_movemask_epi8(x));
+  }
+
+  __m128i ctrl_;
+};
+
+#else
+
+class group {
+ public:
+  explicit group(const ctrl_t* p) { std::memcpy(ctrl_, p, c_group_size); }
+
+  unsigned match(ctrl_t h) const {
+    unsigned res = 0;
+    for (size_t i = 0; i < c_group_size; ++i)
+      res |= static_cast<unsigned>(ctrl_[i] == h) << i;
+    return res;
+  }
+
+  unsigned match_empty() const { return match(c_empty); }
+
+  unsigned match_empty_or_deleted() const {
+    unsigned res = 0;
+    for (size_t i = 0; i < c_group_size; ++i)
+      res |= static_cast<unsigned>(ctrl_[i] < -1) << i;
+    return res;
+  }
+
+ private:
+  ctrl_t ctrl_[c_group_size];
+};
+
+#endif
+
+// Triangular probing over groups. With a power of 2 capacity it visits every
+// group exactly once before repeating.
+class probe_seq {
+ public:
+  probe_seq(size_t hash, size_t mask) : mask_(mask), offset_(hash & mask) {}
+
+  size_t offset() const { return offset_; }
+  size_t offset(size_t i) const { return (offset_ + i) & mask_; }
+
+  void next() {
+    index_ += c_group_size;
+    offset_ = (offset_ + index_) & mask_;
+  }
+
+ private:
+  size_t mask_;
+  size_t offset_;
+  size_t index_ = 0;
+};
+
+// Open addressing table with SIMD probing of 16 control bytes at a time
+// (Swiss table). Slots are never moved unless the table is rehashed.
+// KeyOf extracts the key from a slot.
+template <typename Slot, typename KeyOf, typename Hash, typename Eq>
+class raw_table {
+ public:
+  raw_table() = default;
+  raw_table(Hash hash, Eq eq) : hash_(hash), eq_(eq) {}
+
+  raw_table(const raw_table& x) : hash_(x.hash_), eq_(x.eq_) {
+    reserve(x.size());
+    x.for_each([&](const Slot& slot) {
+      emplace_new(prepare_insert(hashed(KeyOf{}(slot))), slot);
+    });
+  }
+
+  raw_table(raw_table&& x) noexcept { swap(x); }
+
+  raw_table& operator=(raw_table x) noexcept {
+    swap(x);
+    return *this;
+  }
+
+  ~raw_table() { destroy(); }
+
+  void swap(raw_table& x) noexcept {
+    using std::swap;
+    swap(hash_, x.hash_);
+    swap(eq_, x.eq_);
+    swap(ctrl_, x.ctrl_);
+    swap(slots_, x.slots_);
+    swap(capacity_, x.capacity_);
+    swap(size_, x.size_);
+    swap(growth_left_, x.growth_left_);
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return capacity_; }
+
+  void clear() {
+    raw_table tmp(hash_, eq_);
+    swap(tmp);
+  }
+
+  // Makes sure that n elements fit without rehashing.
+  void reserve(size_t n) {
+    if (n <= size_ + growth_left_)
+      return;
+    size_t new_capacity = c_min_capacity;
+    while (max_load(new_capacity) < n)
+      new_capacity *= 2;
+    rehash(new_capacity);
+  }
+
+  template <typename K>
+  const Slot* find(const K& key) const {
+    const size_t i = find_index(key, hashed(key));
+    return i == capacity_ ? nullptr : slots_ + i;
+  }
+
+  template <typename K>
+  Slot* find(const K& key) {
+    return const_cast<Slot*>(static_cast<const raw_table&>(*this).find(key));
+  }
+
+  // Constructs a slot from args if there is no key yet.
+  template <typename K, typename... Args>
+  std::pair<Slot*, bool> try_emplace(const K& key, Args&&... args) {
+    const auto hash = hashed(key);
+    const size_t i = find_index(key, hash);
+    if (i != capacity_)
+      return {slots_ + i, false};
+    return {emplace_new(prepare_insert(hash), std::forward<Args>(args)...),
+            true};
+  }
+
+  template <typename K>
+  size_t erase(const K& key) {
+    const size_t i = find_index(key, hashed(key));
+    if (i == capacity_)
+      return 0;
+    slots_[i].~Slot();
+    // Keeps probe sequences that go through this slot intact.
+    set_ctrl(i, c_deleted);
+    --size_;
+    return 1;
+  }
+
+  // Calls f for each element, in no particular order.
+  template <typename F>
+  void for_each(F f) const {
+    for (size_t i = 0; i < capacity_; ++i)
+      if (is_full(ctrl_[i]))
+        f(static_cast<const Slot&>(slots_[i]));
+  }
+
+ private:
+  static size_t max_load(size_t capacity) { return capacity - capacity / 8; }
+
+  template <typename K>
+  std::uint64_t hashed(const K& key) const {
+    return mix(static_cast<std::uint64_t>(hash_(key)));
+  }
+
+  // capacity_ if there is no such key.
+  template <typename K>
+  size_t find_index(const K& key, std::uint64_t hash) const {
+    if (capacity_ == 0)
+      return capacity_;
+    probe_seq seq(h1(hash), capacity_ - 1);
+    while (true) {
+      const group g(ctrl_ + seq.offset());
+      for (auto m = g.match(h2(hash)); m; m &= m - 1) {
+        const size_t i = seq.offset(number_of_trailing_zeros(m));
+        if (eq_(KeyOf{}(slots_[i]), key))
+          return i;
+      }
+      if (g.match_empty())
+        return capacity_;
+      seq.next();
+    }
+  }
+
+  size_t find_first_non_full(std::uint64_t hash) const {
+    probe_seq seq(h1(hash), capacity_ - 1);
+    while (true) {
+      const auto m = group(ctrl_ + seq.offset()).match_empty_or_deleted();
+      if (m)
+        return seq.offset(number_of_trailing_zeros(m));
+      seq.next();
+    }
+  }
+
+  // Returns a free slot for a key that is known not to be in the table,
+  // growing if needed. The control byte is already set.
+  size_t prepare_insert(std::uint64_t hash) {
+    if (growth_left_ == 0) {
+      // Lots of tombstones: cleaning them up is enough.
+      if (capacity_ != 0 && size_ <= max_load(capacity_) / 2)
+        rehash(capacity_);
+      else
+        rehash(std::max(capacity_ * 2, c_min_capacity));
+    }
+    const size_t i = find_first_non_full(hash);
+    growth_left_ -= ctrl_[i] == c_empty;
+    set_ctrl(i, h2(hash));
+    ++size_;
+    return i;
+  }
+
+  template <typename... Args>
+  Slot* emplace_new(size_t i, Args&&... args) {
+    return ::new (static_cast<void*>(slots_ + i))
+        Slot(std::forward<Args>(args)...);
+  }
+
+  // The first group_size - 1 bytes are mirrored after the end, so that a
+  // group can be loaded from any position without wrapping.
+  void set_ctrl(size_t i, ctrl_t h) {
+    ctrl_[i] = h;
+    if (i < c_group_size - 1)
+      ctrl_[capacity_ + i] = h;
+  }
+
+  void rehash(size_t new_capacity) {
+    raw_table old(hash_, eq_);
+    swap(old);
+
+    capacity_ = new_capacity;
+    ctrl_ = new ctrl_t[capacity_ + c_group_size - 1];
+    std::fill(ctrl_, ctrl_ + capacity_ + c_group_size - 1, c_empty);
+    slots_ = std::allocator<Slot>{}.allocate(capacity_);
+    growth_left_ = max_load(capacity_);
+
+    for (size_t i = 0; i < old.capacity_; ++i) {
+      if (!is_full(old.ctrl_[i]))
+        continue;
+      emplace_new(prepare_insert(hashed(KeyOf{}(old.slots_[i]))),
+                  std::move(old.slots_[i]));
+    }
+  }
+
+  void destroy() {
+    if (capacity_ == 0)
+      return;
+    for (size_t i = 0; i < capacity_; ++i)
+      if (is_full(ctrl_[i]))
+        slots_[i].~Slot();
+    std::allocator<Slot>{}.deallocate(slots_, capacity_);
+    delete[] ctrl_;
+  }
+
+  Hash hash_;
+  Eq eq_;
+  ctrl_t* ctrl_ = nullptr;
+  Slot* slots_ = nullptr;
+  size_t capacity_ = 0;
+  size_t size_ = 0;
+  size_t growth_left_ = 0;
+};
+
+struct identity_key {
+  template <typename T>
+  const T& operator()(const T& x) const {
+    return x;
+  }
+};
+
+struct first_key {
+  template <typename T>
+  const typename T::first_type& operator()(const T& x) const {
+    return x.first;
+  }
+};
+
+}  // namespace swiss
+}  // namespace helpers
+
+namespace containers {
+
+// Hash set in the style of absl::flat_hash_set: open addressing, one control
+// byte per slot, 16 slots probed at once. Works with move only types.
+template <typename T,
+          typename Hash = std::hash<T>,
+          typename Eq = std::equal_to<>>
+class swiss_set {
+ public:
+  using value_type = T;
+
+  swiss_set() = default;
+  swiss_set(Hash hash, Eq eq) : table_(hash, eq) {}
+
+  size_t size() const { return table_.size(); }
+  bool empty() const { return table_.empty(); }
+  size_t capacity() const { return table_.capacity(); }
+  void reserve(size_t n) { table_.reserve(n); }
+  void clear() { table_.clear(); }
+
+  // nullptr if there is no such element.
+  template <typename K>
+  const T* find(const K& key) const {
+    return table_.find(key);
+  }
+
+  template <typename K>
+  bool contains(const K& key) const {
+    return find(key) != nullptr;
+  }
+
+  std::pair<const T*, bool> insert(T value) {
+    const T& key = value;
+    auto res = table_.try_emplace(key, std::move(value));
+    return {res.first, res.second};
+  }
+
+  template <typename... Args>
+  std::pair<const T*, bool> emplace(Args&&... args) {
+    return insert(T(std::forward<Args>(args)...));
+  }
+
+  template <typename I>
+  // requires InputIterator<I>
+  void insert(I f, I l) {
+    insert_range(f, l, typename std::iterator_traits<I>::iterator_category{});
+  }
+
+  template <typename K>
+  size_t erase(const K& key) {
+    return table_.erase(key);
+  }
+
+  template <typename F>
+  void for_each(F f) const {
+    table_.for_each(f);
+  }
+
+ private:
+  template <typename I>
+  void insert_range(I f, I l, std::input_iterator_tag) {
+    for (; f != l; ++f)
+      emplace(*f);
+  }
+
+  // Reserving for all elements is a guess if there are duplicates, but
+  // rehashing once up front is much cheaper than growing several times.
+  template <typename I>
+  void insert_range(I f, I l, std::forward_iterator_tag) {
+    table_.reserve(size() + static_cast<size_t>(std::distance(f, l)));
+    insert_range(f, l, std::input_iterator_tag{});
+  }
+
+  helpers::swiss::raw_table<T, helpers::swiss::identity_key, Hash, Eq> table_;
+};
+
+// Map counterpart of swiss_set, stores std::pair<K, V>.
+template <typename K,
+          typename V,
+          typename Hash = std::hash<K>,
+          typename Eq = std::equal_to<>>
+class swiss_map {
+ public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+
+  swiss_map() = default;
+  swiss_map(Hash hash, Eq eq) : table_(hash, eq) {}
+
+  size_t size() const { return table_.size(); }
+  bool empty() const { return table_.empty(); }
+  size_t capacity() const { return table_.capacity(); }
+  void reserve(size_t n) { table_.reserve(n); }
+  void clear() { table_.clear(); }
+
+  // nullptr if there is no such key.
+  const V* find(const K& key) const {
+    const auto* slot = table_.find(key);
+    return slot ? &slot->second : nullptr;
+  }
+
+  V* find(const K& key) {
+    return const_cast<V*>(static_cast<const swiss_map&>(*this).find(key));
+  }
+
+  bool contains(const K& key) const { return find(key) != nullptr; }
+
+  // Does nothing if the key is already there, like std::map::try_emplace.
+  template <typename... Args>
+  std::pair<V*, bool> emplace(K key, Args&&... args) {
+    auto res = table_.try_emplace(key, std::piecewise_construct,
+                                  std::forward_as_tuple(std::move(key)),
+                                  std::forward_as_tuple(
+                                      std::forward<Args>(args)...));
+    return {&res.first->second, res.second};
+  }
+
+  // [f, l) are (key, value) pairs. For equal keys the first one wins.
+  template <typename I>
+  // requires InputIterator<I>
+  void insert(I f, I l) {
+    insert_range(f, l, typename std::iterator_traits<I>::iterator_category{});
+  }
+
+  size_t erase(const K& key) { return table_.erase(key); }
+
+  template <typename F>
+  void for_each(F f) const {
+    table_.for_each(f);
+  }
+
+ private:
+  template <typename I>
+  void insert_range(I f, I l, std::input_iterator_tag) {
+    for (; f != l; ++f) {
+      auto&& x = *f;
+      emplace(std::forward<decltype(x)>(x).first,
+              std::forward<decltype(x)>(x).second);
+    }
+  }
+
+  template <typename I>
+  void insert_range(I f, I l, std::forward_iterator_tag) {
+    table_.reserve(size() + static_cast<size_t>(std::distance(f, l)));
+    insert_range(f, l, std::input_iterator_tag{});
+  }
+
+  helpers::swiss::raw_table<value_type, helpers::swiss::first_key, Hash, Eq>
+      table_;
+};
+
+}  // namespace containers
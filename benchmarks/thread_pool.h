@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace concurrency {
+
+// Fixed size pool for fork-join loops. The thread calling parallel_for works
+// on its own loop too, so nested and concurrent parallel_for calls can't
+// deadlock, and size() threads take part in every loop.
+class thread_pool {
+ public:
+  explicit thread_pool(size_t size) {
+    for (size_t i = 1; i < std::max<size_t>(size, 1); ++i)
+      workers_.emplace_back([this] { work(); });
+  }
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    has_jobs_.notify_all();
+    for (auto& worker : workers_)
+      worker.join();
+  }
+
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator=(const thread_pool&) = delete;
+
+  size_t size() const { return workers_.size() + 1; }
+
+  // Calls f(i) for every i in [0, n) and waits for all of them.
+  template <typename F>
+  // requires UnaryFunction<F, size_t>
+  void parallel_for(size_t n, F f) {
+    if (n == 0)
+      return;
+    if (n == 1 || workers_.empty()) {
+      for (size_t i = 0; i < n; ++i)
+        f(i);
+      return;
+    }
+
+    auto j = std::make_shared<job>(n, std::function<void(size_t)>(f));
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.push_back(j);
+    }
+    has_jobs_.notify_all();
+
+    while (run_one(*j)) {
+    }
+    while (j->done.load(std::memory_order_acquire) != n)
+      std::this_thread::yield();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = std::find(jobs_.begin(), jobs_.end(), j);
+    if (found != jobs_.end())
+      jobs_.erase(found);
+  }
+
+  // Shared by all algorithms that don't get an explicit pool.
+  static thread_pool& shared() {
+    static thread_pool pool(std::thread::hardware_concurrency());
+    return pool;
+  }
+
+ private:
+  struct job {
+    job(size_t n, std::function<void(size_t)> f) : n(n), f(std::move(f)) {}
+
+    const size_t n;
+    const std::function<void(size_t)> f;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+  };
+
+  static bool run_one(job& j) {
+    const size_t i = j.next.fetch_add(1, std::memory_order_relaxed);
+    if (i >= j.n)
+      return false;
+    j.f(i);
+    j.done.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  void work() {
+    while (true) {
+      std::shared_ptr<job> j;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        has_jobs_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (stop_)
+          return;
+        j = jobs_.front();
+        if (j->next.load(std::memory_order_relaxed) >= j->n) {
+          jobs_.pop_front();
+          continue;
+        }
+      }
+      while (run_one(*j)) {
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable has_jobs_;
+  std::deque<std::shared_ptr<job>> jobs_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace concurrency
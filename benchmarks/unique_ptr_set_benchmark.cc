@@ -1,5 +1,5 @@
 #include <algorithm>
-#include <array>
+#include <iterator>
 #include <vector>
 #include <set>
 #include <map>
@@ -8,24 +8,33 @@
 
 #include "base/containers/flat_set.h"
 #include "base/containers/flat_map.h"
-#include "third_party/benchmark/include/benchmark/benchmark.h"
+#include "benchmarks/allocation_tracking.h"
+#include "benchmarks/btree.h"
+#include "benchmarks/input_ring.h"
+#include "benchmarks/split_flat_map.h"
+#include "benchmarks/swiss_table.h"
+#include "benchmark/benchmark.h"
 
 namespace {
 
-constexpr size_t kElementsSize = 100;
+constexpr size_t kMinElementsSize = 100;
+constexpr size_t kMaxElementsSize = 10000000;
+// Emplacing one by one into a sorted vector is quadratic.
+constexpr size_t kMaxFlatElementsSize = 100000;
 
-using ptr_array = std::array<int*, kElementsSize>;
+const std::vector<int*>& input(size_t size) {
+  static std::map<size_t, std::vector<int*>> cached_inputs;
 
-const ptr_array& input() {
-  static const ptr_array cached_res = [] {
-    ptr_array ptrs;
+  auto found = cached_inputs.find(size);
+  if (found == cached_inputs.end()) {
+    std::vector<int*> ptrs(size);
     std::mt19937 g;
     std::uniform_int_distribution<> dis;
     std::generate(ptrs.begin(), ptrs.end(),
                   [&] { return reinterpret_cast<int*>(dis(g)); });
-    return ptrs;
-  }();
-  return cached_res;
+    found = cached_inputs.emplace(size, std::move(ptrs)).first;
+  }
+  return found->second;
 }
 
 struct do_nothing {
@@ -40,6 +49,10 @@ using fl_set = base::flat_set<unique_t>;
 using fl_map = base::flat_map<int*, unique_t>;
 using std_set = std::set<unique_t>;
 using std_map = std::map<int*, unique_t>;
+using split_map = containers::split_flat_map<int*, unique_t>;
+using swiss_set = containers::swiss_set<unique_t>;
+using swiss_map = containers::swiss_map<int*, unique_t>;
+using btree_set = containers::btree_set<unique_t>;
 
 template <typename C>
 class insert_unique_ptr_t {
@@ -57,6 +70,14 @@ public:
 
   static void run(std_map& c, int* v) { c.emplace(v, unique_t(v)); }
 
+  static void run(split_map& c, int* v) { c.emplace(v, unique_t(v)); }
+
+  static void run(swiss_set& c, int* v) { c.emplace(unique_t(v)); }
+
+  static void run(swiss_map& c, int* v) { c.emplace(v, unique_t(v)); }
+
+  static void run(btree_set& c, int* v) { c.emplace(unique_t(v)); }
+
   C* c_;
 };
 
@@ -65,15 +86,44 @@ auto insert_unique_ptr(C& c) {
   return insert_unique_ptr_t<C>{c};
 }
 
+// state.range(0) is the number of elements.
 template <typename C>
 void benchmark_insert_unique_ptrs(benchmark::State& state) {
-  (void)input();
+  const auto& ptrs = input(static_cast<size_t>(state.range(0)));
+  helpers::allocation_tracker allocations;
   while (state.KeepRunning()) {
     C c;
     auto inserter = insert_unique_ptr(c);
-    for (const auto& ptr : input())
+    for (const auto& ptr : ptrs)
       inserter(ptr);
   }
+  allocations.report(state);
+}
+
+// Bulk insert, for the containers that have one. The values to move in
+// are made untimed, in a ring, see input_ring.h.
+template <typename C>
+void benchmark_bulk_insert_unique_ptrs(benchmark::State& state) {
+  const auto& ptrs = input(static_cast<size_t>(state.range(0)));
+  using values_type = std::vector<unique_t>;
+  std::vector<values_type> ring(
+      helpers::input_ring_size(ptrs.size() * sizeof(unique_t)));
+  auto refill = [&](std::vector<values_type>& inputs) {
+    for (auto& values : inputs) {
+      values.clear();
+      for (const auto& ptr : ptrs)
+        values.emplace_back(ptr);
+    }
+  };
+  refill(ring);
+
+  helpers::run_on_ring(state, ring,
+                       [](values_type& values) {
+                         C c;
+                         c.insert(std::make_move_iterator(values.begin()),
+                                  std::make_move_iterator(values.end()));
+                       },
+                       refill);
 }
 
 void benchmark_flat_set(benchmark::State& state) {
@@ -92,10 +142,48 @@ void benchmark_std_map(benchmark::State& state) {
   benchmark_insert_unique_ptrs<std_map>(state);
 }
 
-BENCHMARK(benchmark_flat_set);
-BENCHMARK(benchmark_flat_map);
-BENCHMARK(benchmark_std_set);
-BENCHMARK(benchmark_std_map);
+void benchmark_split_flat_map(benchmark::State& state) {
+  benchmark_insert_unique_ptrs<split_map>(state);
+}
+
+void benchmark_swiss_set(benchmark::State& state) {
+  benchmark_insert_unique_ptrs<swiss_set>(state);
+}
+
+void benchmark_swiss_map(benchmark::State& state) {
+  benchmark_insert_unique_ptrs<swiss_map>(state);
+}
+
+void benchmark_swiss_set_bulk(benchmark::State& state) {
+  benchmark_bulk_insert_unique_ptrs<swiss_set>(state);
+}
+
+void benchmark_btree_set(benchmark::State& state) {
+  benchmark_insert_unique_ptrs<btree_set>(state);
+}
+
+void benchmark_btree_set_bulk(benchmark::State& state) {
+  benchmark_bulk_insert_unique_ptrs<btree_set>(state);
+}
+
+void set_sizes(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(kMinElementsSize, kMaxElementsSize);
+}
+
+void set_flat_sizes(benchmark::internal::Benchmark* bench) {
+  bench->RangeMultiplier(10)->Range(kMinElementsSize, kMaxFlatElementsSize);
+}
+
+BENCHMARK(benchmark_flat_set)->Apply(set_flat_sizes);
+BENCHMARK(benchmark_flat_map)->Apply(set_flat_sizes);
+BENCHMARK(benchmark_std_set)->Apply(set_sizes);
+BENCHMARK(benchmark_std_map)->Apply(set_sizes);
+BENCHMARK(benchmark_split_flat_map)->Apply(set_flat_sizes);
+BENCHMARK(benchmark_swiss_set)->Apply(set_sizes);
+BENCHMARK(benchmark_swiss_map)->Apply(set_sizes);
+BENCHMARK(benchmark_swiss_set_bulk)->Apply(set_sizes);
+BENCHMARK(benchmark_btree_set)->Apply(set_sizes);
+BENCHMARK(benchmark_btree_set_bulk)->Apply(set_sizes);
 }
 
 BENCHMARK_MAIN();
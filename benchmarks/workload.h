@@ -0,0 +1,384 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace workload {
+
+enum class sweep_kind { linear, geometric };
+
+// How the inserted keys are picked. The keys already in the set are always
+// uniform over [1, distribution_size].
+enum class distribution_kind {
+  uniform,            // over [1, distribution_size]
+  zipfian,            // small numbers are hot, P(k) ~ 1 / k^zipf_exponent
+  sequential,         // consecutive numbers from a random start
+  clustered,          // normal around `clusters` random centers
+  mostly_duplicates,  // c_mostly_percent of them are already in the set
+  mostly_new,         // c_mostly_percent of them are not in the set
+};
+
+enum class key_kind { int32, int64, string };
+
+constexpr int c_mostly_percent = 90;
+// Digits in string keys: long enough to not fit into the small string buffer.
+constexpr size_t c_string_key_digits = 24;
+
+// Everything that describes the inputs of a bulk insert benchmark. The
+// defaults are the workload the checked in jsons were measured with, except
+// for the set size of flat_set_insert_100_1000000.
+struct spec {
+  size_t set_size = 1000;
+  std::uint64_t distribution_size = 1000000;
+
+  // Batch sizes from min_batch to max_batch, both included: adding step or
+  // multiplying by factor.
+  size_t min_batch = 1;
+  size_t max_batch = 999;
+  sweep_kind sweep = sweep_kind::linear;
+  size_t step = 1;
+  double factor = 2;
+
+  distribution_kind distribution = distribution_kind::uniform;
+  double zipf_exponent = 1;
+  size_t clusters = 16;
+
+  key_kind key = key_kind::int32;
+  std::uint32_t seed = 0;
+};
+
+namespace detail {
+
+inline std::uint64_t parse_number(const std::string& name,
+                                  const std::string& value) {
+  char* end = nullptr;
+  const auto res = std::strtoull(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0')
+    throw std::invalid_argument(name + ": not a number: " + value);
+  return res;
+}
+
+inline double parse_double(const std::string& name, const std::string& value) {
+  char* end = nullptr;
+  const double res = std::strtod(value.c_str(), &end);
+  if (value.empty() || *end != '\0')
+    throw std::invalid_argument(name + ": not a number: " + value);
+  return res;
+}
+
+template <typename E, size_t N>
+E parse_enum(const std::string& name,
+             const std::string& value,
+             const char* const (&names)[N]) {
+  for (size_t i = 0; i < N; ++i) {
+    if (value == names[i])
+      return static_cast<E>(i);
+  }
+  throw std::invalid_argument(name + ": unknown value: " + value);
+}
+
+constexpr const char* c_sweep_names[] = {"linear", "geometric"};
+constexpr const char* c_distribution_names[] = {
+    "uniform",    "zipfian",           "sequential",
+    "clustered",  "mostly_duplicates", "mostly_new"};
+constexpr const char* c_key_names[] = {"int32", "int64", "string"};
+
+inline std::string trim(const std::string& s) {
+  const auto f = s.find_first_not_of(" \t\r");
+  if (f == std::string::npos)
+    return {};
+  return s.substr(f, s.find_last_not_of(" \t\r") - f + 1);
+}
+
+}  // namespace detail
+
+inline const char* name(distribution_kind d) {
+  return detail::c_distribution_names[static_cast<size_t>(d)];
+}
+
+inline const char* name(key_kind k) {
+  return detail::c_key_names[static_cast<size_t>(k)];
+}
+
+// Field names and values, in the form set_field takes them.
+inline std::vector<std::pair<std::string, std::string>> describe(
+    const spec& s) {
+  auto number = [](double x) {
+    std::string res = std::to_string(x);
+    res.erase(res.find_last_not_of('0') + 1);
+    if (res.back() == '.')
+      res.pop_back();
+    return res;
+  };
+  return {{"set_size", std::to_string(s.set_size)},
+          {"distribution_size", std::to_string(s.distribution_size)},
+          {"min_batch", std::to_string(s.min_batch)},
+          {"max_batch", std::to_string(s.max_batch)},
+          {"sweep", detail::c_sweep_names[static_cast<size_t>(s.sweep)]},
+          {"step", std::to_string(s.step)},
+          {"factor", number(s.factor)},
+          {"distribution", name(s.distribution)},
+          {"zipf_exponent", number(s.zipf_exponent)},
+          {"clusters", std::to_string(s.clusters)},
+          {"key_type", name(s.key)},
+          {"seed", std::to_string(s.seed)}};
+}
+
+// Sets one field by its name, throws std::invalid_argument for unknown names
+// and bad values.
+inline void set_field(spec& s, const std::string& name,
+                      const std::string& value) {
+  using namespace detail;
+  if (name == "set_size")
+    s.set_size = parse_number(name, value);
+  else if (name == "distribution_size")
+    s.distribution_size = parse_number(name, value);
+  else if (name == "min_batch")
+    s.min_batch = parse_number(name, value);
+  else if (name == "max_batch")
+    s.max_batch = parse_number(name, value);
+  else if (name == "sweep")
+    s.sweep = parse_enum<sweep_kind>(name, value, c_sweep_names);
+  else if (name == "step")
+    s.step = parse_number(name, value);
+  else if (name == "factor")
+    s.factor = parse_double(name, value);
+  else if (name == "distribution")
+    s.distribution =
+        parse_enum<distribution_kind>(name, value, c_distribution_names);
+  else if (name == "zipf_exponent")
+    s.zipf_exponent = parse_double(name, value);
+  else if (name == "clusters")
+    s.clusters = parse_number(name, value);
+  else if (name == "key_type")
+    s.key = parse_enum<key_kind>(name, value, c_key_names);
+  else if (name == "seed")
+    s.seed = static_cast<std::uint32_t>(parse_number(name, value));
+  else
+    throw std::invalid_argument("unknown workload field: " + name);
+}
+
+inline void check(const spec& s) {
+  if (s.set_size >= s.distribution_size)
+    throw std::invalid_argument("set_size has to be below distribution_size");
+  if (s.min_batch == 0 || s.min_batch > s.max_batch)
+    throw std::invalid_argument("bad batch range");
+  if (s.sweep == sweep_kind::linear ? s.step == 0 : s.factor <= 1)
+    throw std::invalid_argument("batch sweep doesn't advance");
+  if (s.clusters == 0)
+    throw std::invalid_argument("clusters has to be positive");
+
+  // make_key would wrap around.
+  using int32_limits = std::numeric_limits<std::int32_t>;
+  using int64_limits = std::numeric_limits<std::int64_t>;
+  const auto max_key =
+      s.key == key_kind::int32
+          ? static_cast<std::uint64_t>(int32_limits::max())
+          : static_cast<std::uint64_t>(int64_limits::max());
+  if (s.key != key_kind::string && s.distribution_size > max_key)
+    throw std::invalid_argument("distribution_size doesn't fit key_type");
+}
+
+// One `name = value` per line, # starts a comment.
+inline void load_spec_file(spec& s, const std::string& path) {
+  std::ifstream in(path);
+  if (!in)
+    throw std::invalid_argument("can't open workload spec " + path);
+  std::string line;
+  while (std::getline(in, line)) {
+    line = detail::trim(line.substr(0, line.find('#')));
+    if (line.empty())
+      continue;
+    const auto eq = line.find('=');
+    if (eq == std::string::npos)
+      throw std::invalid_argument("expected name = value: " + line);
+    set_field(s, detail::trim(line.substr(0, eq)),
+              detail::trim(line.substr(eq + 1)));
+  }
+}
+
+// Takes --workload_<field>=<value> and --workload_spec=<file> out of argv,
+// later ones override earlier ones. The rest is left for the benchmark
+// library.
+inline spec parse_command_line(int& argc, char** argv) {
+  const std::string prefix = "--workload_";
+  spec res;
+  int out = 1;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const auto eq = arg.find('=');
+    if (arg.compare(0, prefix.size(), prefix) != 0 ||
+        eq == std::string::npos) {
+      argv[out++] = argv[i];
+      continue;
+    }
+    const auto name = arg.substr(prefix.size(), eq - prefix.size());
+    const auto value = arg.substr(eq + 1);
+    if (name == "spec")
+      load_spec_file(res, value);
+    else
+      set_field(res, name, value);
+  }
+  argc = out;
+  check(res);
+  return res;
+}
+
+inline std::vector<size_t> batch_sizes(const spec& s) {
+  std::vector<size_t> res;
+  for (size_t size = s.min_batch; size <= s.max_batch;) {
+    res.push_back(size);
+    if (s.sweep == sweep_kind::linear) {
+      size += s.step;
+    } else {
+      // Rounding down could get stuck on small sizes.
+      size = std::max(size + 1, static_cast<size_t>(size * s.factor));
+    }
+  }
+  return res;
+}
+
+// Keys are generated as numbers and converted, strings are zero padded so
+// that they sort like the numbers.
+template <typename T>
+T make_key(std::uint64_t x) {
+  return static_cast<T>(x);
+}
+
+template <>
+inline std::string make_key<std::string>(std::uint64_t x) {
+  std::string digits = std::to_string(x);
+  return std::string(c_string_key_digits - digits.size(), '0') + digits;
+}
+
+// Numbers in [1, distribution_size].
+inline std::vector<std::uint64_t> generate_numbers(
+    const spec& s,
+    size_t count,
+    const std::vector<std::uint64_t>& already_in,
+    std::mt19937& g) {
+  std::uniform_int_distribution<std::uint64_t> uniform(1, s.distribution_size);
+  auto clamp = [&](double x) {
+    return static_cast<std::uint64_t>(std::min(
+        std::max(x, 1.0), static_cast<double>(s.distribution_size)));
+  };
+  auto in_set = [&](std::uint64_t x) {
+    return std::binary_search(already_in.begin(), already_in.end(), x);
+  };
+  std::uniform_int_distribution<> percent(0, 99);
+
+  std::vector<std::uint64_t> res(count);
+  switch (s.distribution) {
+    case distribution_kind::uniform:
+      std::generate(res.begin(), res.end(), [&] { return uniform(g); });
+      break;
+    case distribution_kind::zipfian: {
+      // Inverse of the continuous power law CDF, close enough to the
+      // discrete one for benchmarking.
+      const double n = static_cast<double>(s.distribution_size);
+      const double a = 1 - s.zipf_exponent;
+      std::uniform_real_distribution<> u(0, 1);
+      std::generate(res.begin(), res.end(), [&] {
+        if (std::abs(a) < 1e-9)
+          return clamp(std::pow(n, u(g)));
+        return clamp(std::pow((std::pow(n, a) - 1) * u(g) + 1, 1 / a));
+      });
+      break;
+    }
+    case distribution_kind::sequential: {
+      std::uint64_t x = uniform(g);
+      for (auto& r : res) {
+        r = x;
+        x = x == s.distribution_size ? 1 : x + 1;
+      }
+      break;
+    }
+    case distribution_kind::clustered: {
+      std::vector<double> centers(s.clusters);
+      for (auto& c : centers)
+        c = static_cast<double>(uniform(g));
+      std::uniform_int_distribution<size_t> pick(0, s.clusters - 1);
+      std::normal_distribution<> offset(
+          0, static_cast<double>(s.distribution_size) /
+                 static_cast<double>(s.clusters * 100));
+      std::generate(res.begin(), res.end(), [&] {
+        return clamp(centers[pick(g)] + offset(g));
+      });
+      break;
+    }
+    case distribution_kind::mostly_duplicates:
+    case distribution_kind::mostly_new: {
+      const bool duplicates =
+          s.distribution == distribution_kind::mostly_duplicates;
+      std::uniform_int_distribution<size_t> pick(0, already_in.size() - 1);
+      for (auto& r : res) {
+        const bool duplicate = (percent(g) < c_mostly_percent) == duplicates;
+        if (duplicate && !already_in.empty()) {
+          r = already_in[pick(g)];
+          continue;
+        }
+        do {
+          r = uniform(g);
+        } while (in_set(r));
+      }
+      break;
+    }
+  }
+  return res;
+}
+
+template <typename T>
+std::vector<T> make_keys(const std::vector<std::uint64_t>& numbers) {
+  std::vector<T> res;
+  res.reserve(numbers.size());
+  for (auto x : numbers)
+    res.push_back(make_key<T>(x));
+  return res;
+}
+
+// Generates the set once, batches of every size from it. The same spec
+// always gives the same keys, batches of different sizes are independent.
+class generator {
+ public:
+  explicit generator(const workload::spec& s) : spec_(s) {
+    check(spec_);
+    std::mt19937 g(spec_.seed);
+    std::uniform_int_distribution<std::uint64_t> uniform(
+        1, spec_.distribution_size);
+    std::set<std::uint64_t> already_in;
+    while (already_in.size() < spec_.set_size)
+      already_in.insert(uniform(g));
+    set_.assign(already_in.begin(), already_in.end());
+  }
+
+  const workload::spec& spec() const { return spec_; }
+
+  // Sorted and unique.
+  template <typename T>
+  std::vector<T> set() const {
+    return make_keys<T>(set_);
+  }
+
+  template <typename T>
+  std::vector<T> batch(size_t batch_size) const {
+    std::mt19937 g(spec_.seed + static_cast<std::uint32_t>(batch_size));
+    return make_keys<T>(generate_numbers(spec_, batch_size, set_, g));
+  }
+
+ private:
+  workload::spec spec_;
+  std::vector<std::uint64_t> set_;
+};
+
+}  // namespace workload
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Compares google benchmark json outputs.
+
+The first file is the baseline, every other one is compared to it.
+Benchmarks are matched by name (which includes the args). With
+--benchmark_repetitions the speedup gets a bootstrap confidence interval
+and a Mann-Whitney U test tells noise from a change.
+
+Exits with 1 if some benchmark got slower by more than --threshold (and,
+with repetitions, the change is significant) and with 2 if a file has
+nothing in common with the baseline, so it can guard an upgrade:
+
+  compare_benchmarks.py before.json after.json --threshold 0.05
+"""
+
+import argparse
+import json
+import math
+import random
+import re
+import sys
+
+TIME_UNITS_NS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+
+class Comparison:
+  def __init__(self, name, baseline, contender):
+    self.name = name
+    self.baseline = baseline
+    self.contender = contender
+    self.speedup = median(baseline) / median(contender)
+    self.interval = None
+    self.p_value = None
+    self.regression = False
+    self.improvement = False
+
+def median(xs):
+  s = sorted(xs)
+  middle = len(s) // 2
+  if len(s) % 2:
+    return s[middle]
+  return (s[middle - 1] + s[middle]) / 2.0
+
+# Name -> times in ns of every repetition. Aggregates (mean, median,
+# stddev) are left out, the statistics need the repetitions themselves.
+def loadTimes(path, metric, name_filter):
+  with open(path) as f:
+    loaded = json.load(f)
+
+  times = {}
+  for benchmark in loaded['benchmarks']:
+    if benchmark.get('run_type', 'iteration') != 'iteration':
+      continue
+    if benchmark.get('error_occurred'):
+      continue
+    name = benchmark.get('run_name', benchmark['name'])
+    if name_filter and not name_filter.search(name):
+      continue
+    unit = TIME_UNITS_NS[benchmark.get('time_unit', 'ns')]
+    times.setdefault(name, []).append(float(benchmark[metric]) * unit)
+  return times
+
+def bootstrapInterval(baseline, contender, confidence, resamples, rng):
+  def resampledMedian(xs):
+    return median([rng.choice(xs) for _ in xs])
+
+  speedups = sorted(
+      resampledMedian(baseline) / resampledMedian(contender)
+      for _ in range(resamples))
+  tail = (1 - confidence) / 2
+  low = speedups[int(tail * (resamples - 1))]
+  high = speedups[int(math.ceil((1 - tail) * (resamples - 1)))]
+  return (low, high)
+
+# Two sided p-value of the Mann-Whitney U test, normal approximation with
+# tie correction.
+def mannWhitneyPValue(xs, ys):
+  n1, n2 = len(xs), len(ys)
+  values = sorted([(x, 0) for x in xs] + [(y, 1) for y in ys])
+
+  rank_sum = 0.0
+  tie_term = 0.0
+  i = 0
+  while i < len(values):
+    j = i
+    while j < len(values) and values[j][0] == values[i][0]:
+      j += 1
+    average_rank = (i + 1 + j) / 2.0
+    from_xs = sum(1 for k in range(i, j) if values[k][1] == 0)
+    rank_sum += average_rank * from_xs
+    tie_term += (j - i) ** 3 - (j - i)
+    i = j
+
+  u = rank_sum - n1 * (n1 + 1) / 2.0
+  n = n1 + n2
+  variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+  if variance <= 0:
+    return 1.0
+  z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(variance)
+  return min(1.0, math.erfc(max(z, 0.0) / math.sqrt(2)))
+
+def compare(baseline, contender, options, rng):
+  res = []
+  for name, baseline_times in baseline.items():
+    if name not in contender:
+      continue
+    c = Comparison(name, baseline_times, contender[name])
+    slowdown = 1 / c.speedup - 1
+
+    repeated = len(c.baseline) > 1 and len(c.contender) > 1
+    if repeated:
+      c.interval = bootstrapInterval(c.baseline, c.contender,
+                                     options.confidence, options.resamples,
+                                     rng)
+      c.p_value = mannWhitneyPValue(c.baseline, c.contender)
+
+    significant = c.p_value is None or c.p_value < 1 - options.confidence
+    c.regression = significant and slowdown > options.threshold
+    c.improvement = significant and -slowdown > options.threshold
+    res.append(c)
+  return res
+
+def formatTime(ns):
+  for unit in ['ns', 'us', 'ms']:
+    if ns < 1000:
+      return '%.3g %s' % (ns, unit)
+    ns /= 1000.0
+  return '%.3g s' % ns
+
+def printTable(title, comparisons, out):
+  headers = ['benchmark', 'baseline', 'contender', 'speedup', 'interval',
+             'p-value', '']
+  rows = []
+  for c in comparisons:
+    interval = '-'
+    if c.interval:
+      interval = '[%.3f, %.3f]' % c.interval
+    p_value = '-' if c.p_value is None else '%.3f' % c.p_value
+    verdict = ''
+    if c.regression:
+      verdict = 'REGRESSION'
+    elif c.improvement:
+      verdict = 'improvement'
+    rows.append([c.name, formatTime(median(c.baseline)),
+                 formatTime(median(c.contender)), '%.3f' % c.speedup,
+                 interval, p_value, verdict])
+
+  widths = [max(len(str(r[i])) for r in rows + [headers])
+            for i in range(len(headers))]
+  def line(cells):
+    return '  '.join(str(cell).ljust(w)
+                     for cell, w in zip(cells, widths)).rstrip()
+
+  out.write(title + '\n')
+  out.write(line(headers) + '\n')
+  out.write(line(['-' * w for w in widths]) + '\n')
+  for r in rows:
+    out.write(line(r) + '\n')
+
+  regressions = sum(1 for c in comparisons if c.regression)
+  improvements = sum(1 for c in comparisons if c.improvement)
+  speedups = [c.speedup for c in comparisons]
+  geomean = math.exp(sum(map(math.log, speedups)) / len(speedups))
+  out.write('%d compared, %d regressions, %d improvements, '
+            'geometric mean speedup %.3f\n\n' %
+            (len(comparisons), regressions, improvements, geomean))
+
+if __name__ == '__main__':
+  options_parser = argparse.ArgumentParser(
+      description='Compares benchmark results against a baseline.')
+  options_parser.add_argument('baseline', help='baseline json')
+  options_parser.add_argument('contenders', nargs='+',
+                              help='jsons to compare to the baseline')
+  options_parser.add_argument('--metric', default='real_time',
+                              choices=['real_time', 'cpu_time'])
+  options_parser.add_argument('--threshold', type=float, default=0.05,
+                              help='slowdown that counts as a regression, '
+                                   '0.05 is 5%%')
+  options_parser.add_argument('--confidence', type=float, default=0.95,
+                              help='of the speedup interval, 1 - confidence '
+                                   'is the significance level of the test')
+  options_parser.add_argument('--resamples', type=int, default=2000,
+                              help='bootstrap resamples')
+  options_parser.add_argument('--filter', default=None,
+                              help='regex, only matching benchmark names')
+  options_parser.add_argument('--seed', type=int, default=0)
+  options = options_parser.parse_args()
+
+  name_filter = re.compile(options.filter) if options.filter else None
+  rng = random.Random(options.seed)
+  baseline = loadTimes(options.baseline, options.metric, name_filter)
+
+  failed = False
+  error = False
+  for path in options.contenders:
+    contender = loadTimes(path, options.metric, name_filter)
+    comparisons = compare(baseline, contender, options, rng)
+    if not comparisons:
+      sys.stderr.write('%s: no benchmarks in common with %s\n' %
+                       (path, options.baseline))
+      error = True
+      continue
+    printTable('%s vs %s' % (path, options.baseline), comparisons,
+               sys.stdout)
+    failed = failed or any(c.regression for c in comparisons)
+
+  sys.exit(2 if error else 1 if failed else 0)
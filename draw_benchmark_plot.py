@@ -1,118 +1,330 @@
+#!/usr/bin/env python3
+"""Draws google benchmark json outputs into a self-contained HTML report.
+
+Works for the output of any benchmark binary. Benchmarks with the same name
+apart from their first argument are a series, with that argument on the x
+axis. Series with the same x values share a chart. The bulk insert
+benchmarks name their method in the label and their batch size in the
+batch_size counter, older outputs only have them in the name.
+
+  draw_benchmark_plot.py --benchmarks_result_json a.json b.json \\
+      --output report.html --log_x
+"""
+
 import argparse
+import html
 import json
-import plotly
+import math
 import re
-import itertools
 
-from plotly.graph_objs import Scatter, Layout
+TIME_UNITS_NS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+COLORS = ['#1f77b4', '#ff7f0e', '#2ca02c', '#d62728', '#9467bd',
+          '#8c564b', '#e377c2', '#7f7f7f', '#bcbd22', '#17becf']
+
+WIDTH = 960
+HEIGHT = 480
+MARGIN_LEFT = 80
+MARGIN_RIGHT = 320
+MARGIN_TOP = 20
+MARGIN_BOTTOM = 50
 
 class Measurement:
   def __init__(self, input_size, time):
     self.input_size = input_size
     self.time = time
 
-class Title:
-  def __init__(self, set_size, distribution_size):
-    self.set_size = set_size
-    self.distribution_size = distribution_size
-
 class Method:
   def __init__(self, name, measurements):
     self.name = name
     self.main = False
-    self.measurements = measurements
+    self.measurements = sorted(measurements, key=lambda m: m.input_size)
 
     if self.name == 'proposed':
       self.name += ' solution'
       self.main = True
     self.name = self.name.replace('_', ' ')
 
+class Chart:
+  def __init__(self, title, methods, subtracted):
+    self.title = title
+    self.methods = methods
+    self.subtracted = subtracted
 
+# (series name, x or None, time in ns).
 def parseMeasurement(json_dict):
-  parsed_name = re.match(r'(.*?)(_solution)?/(.*)',json_dict['name'])
-  name = parsed_name.group(1)
+  time = json_dict['real_time'] * TIME_UNITS_NS[
+      json_dict.get('time_unit', 'ns')]
+  if json_dict.get('label') and 'batch_size' in json_dict:
+    return (json_dict['label'], int(json_dict['batch_size']), time)
 
-  input_size = int(parsed_name.group(3))
-  time = json_dict['real_time']
-  return (name, Measurement(input_size, time))
+  name = json_dict.get('run_name', json_dict['name'])
+  parts = name.split('/')
+  # Thread counts, real time and such come after the args.
+  args = [p for p in parts[1:] if not re.match(r'^(threads|real_time|'
+                                               r'manual_time|process_time)',
+                                               p)]
+  for i, arg in enumerate(args):
+    value = arg.split(':')[-1]
+    if re.match(r'^-?\d+$', value):
+      rest = args[:i] + args[i + 1:]
+      series = '/'.join([parts[0]] + rest)
+      if not rest:
+        series = re.sub(r'_solution$', '', series)
+      return (series, int(value), time)
+  return (name, None, time)
 
 def parseJson(loaded_benchmarks_json, baseline_name):
-  measurements = {}
-  title = None
+  series = {}
+  no_args = []
   for json_input in loaded_benchmarks_json['benchmarks']:
-    name, m = parseMeasurement(json_input)
-    if 'extra_data' in json_input:
-      set_size = json_input['extra_data']["set_size"]
-      distribution_size = json_input['extra_data']["distribution_size"]
-      title = Title(set_size, distribution_size)
-    measurements.setdefault(name, []).append(m)
-
-  if baseline_name not in measurements:
-    raise "No baseline benchmark found"
-
-  methods = []
-  for name, ms in measurements.iteritems():
-    if name == baseline_name:
+    if json_input.get('run_type', 'iteration') != 'iteration':
+      continue
+    if json_input.get('error_occurred'):
+      continue
+    name, x, time = parseMeasurement(json_input)
+    if x is None:
+      no_args.append((name, time))
+      continue
+    # Repetitions: the last one wins, compare_benchmarks.py is for noise.
+    series.setdefault(name, {})[x] = time
+
+  by_xs = {}
+  for name, points in series.items():
+    by_xs.setdefault(tuple(sorted(points)), []).append(name)
+
+  charts = []
+  for xs, names in by_xs.items():
+    baseline = series[baseline_name] if baseline_name in names else None
+    methods = []
+    for name in names:
+      if name == baseline_name and len(names) > 1:
+        continue
+      ms = []
+      for x in xs:
+        time = series[name][x]
+        if baseline and name != baseline_name:
+          time -= baseline[x]
+        ms.append(Measurement(x, time))
+      methods.append(Method(name, ms))
+    title = commonPrefix([m.name for m in methods])
+    if not title:
+      title = '%d series, input sizes %d .. %d' % (len(methods), xs[0],
+                                                    xs[-1])
+    charts.append(Chart(title, methods, baseline is not None))
+
+  charts.sort(key=lambda c: c.title)
+  return (charts, no_args)
+
+def commonPrefix(names):
+  if len(names) < 2:
+    return ''
+  prefix = names[0]
+  for name in names[1:]:
+    while not name.startswith(prefix):
+      prefix = prefix[:-1]
+  return prefix.strip(' /<')
+
+def formatTime(ns):
+  for unit in ['ns', 'us', 'ms']:
+    if abs(ns) < 1000:
+      return '%.3g %s' % (ns, unit)
+    ns /= 1000.0
+  return '%.3g s' % ns
+
+def formatNumber(x):
+  if x != 0 and (abs(x) >= 1e5 or abs(x) < 1e-2):
+    return '%.0e' % x
+  return '%g' % x
+
+class Axis:
+  def __init__(self, values, log, low, high):
+    values = [v for v in values if not log or v > 0]
+    self.log = log
+    self.low = low
+    self.high = high
+    lo = min(values) if values else 1
+    hi = max(values) if values else 1
+    if log:
+      self.min = 10 ** math.floor(math.log10(lo))
+      self.max = 10 ** math.ceil(math.log10(hi))
+      if self.max == self.min:
+        self.max *= 10
+    else:
+      self.min = min(0, lo)
+      self.max = hi if hi > self.min else self.min + 1
+
+  def position(self, v):
+    if self.log:
+      fraction = ((math.log10(v) - math.log10(self.min)) /
+                  (math.log10(self.max) - math.log10(self.min)))
+    else:
+      fraction = (v - self.min) / (self.max - self.min)
+    return self.low + fraction * (self.high - self.low)
+
+  def ticks(self):
+    if self.log:
+      res = []
+      tick = self.min
+      while tick <= self.max * 1.0001:
+        res.append(tick)
+        tick *= 10
+      return res
+    step = 10 ** math.floor(math.log10((self.max - self.min) / 5))
+    for factor in [1, 2, 5, 10]:
+      if (self.max - self.min) / (step * factor) <= 8:
+        step *= factor
+        break
+    first = math.ceil(self.min / step) * step
+    return [first + i * step
+            for i in range(int((self.max - first) / step + 1e-9) + 1)]
+
+def drawSvg(chart, log_x, log_y):
+  points = [(m.input_size, m.time)
+            for method in chart.methods for m in method.measurements]
+  x_axis = Axis([p[0] for p in points], log_x, MARGIN_LEFT,
+                WIDTH - MARGIN_RIGHT)
+  y_axis = Axis([p[1] for p in points], log_y, HEIGHT - MARGIN_BOTTOM,
+                MARGIN_TOP)
+
+  out = ['<svg xmlns="http://www.w3.org/2000/svg" width="%d" height="%d" '
+         'font-family="sans-serif" font-size="11">' % (WIDTH, HEIGHT)]
+  left, right = MARGIN_LEFT, WIDTH - MARGIN_RIGHT
+  top, bottom = MARGIN_TOP, HEIGHT - MARGIN_BOTTOM
+
+  for tick in x_axis.ticks():
+    x = x_axis.position(tick)
+    out.append('<line x1="%.1f" y1="%d" x2="%.1f" y2="%d" stroke="#eee"/>'
+               % (x, top, x, bottom))
+    out.append('<text x="%.1f" y="%d" text-anchor="middle">%s</text>'
+               % (x, bottom + 15, formatNumber(tick)))
+  for tick in y_axis.ticks():
+    y = y_axis.position(tick)
+    out.append('<line x1="%d" y1="%.1f" x2="%d" y2="%.1f" stroke="#eee"/>'
+               % (left, y, right, y))
+    out.append('<text x="%d" y="%.1f" text-anchor="end">%s</text>'
+               % (left - 5, y + 4, formatTime(tick)))
+  out.append('<rect x="%d" y="%d" width="%d" height="%d" fill="none" '
+             'stroke="#888"/>' % (left, top, right - left, bottom - top))
+  out.append('<text x="%d" y="%d" text-anchor="middle">%s</text>'
+             % ((left + right) / 2, HEIGHT - 10,
+                'input size' + (' (log)' if log_x else '')))
+
+  for i, method in enumerate(chart.methods):
+    color = COLORS[i % len(COLORS)]
+    visible = [m for m in method.measurements
+               if (not log_x or m.input_size > 0) and
+               (not log_y or m.time > 0)]
+    path = ' '.join('%.1f,%.1f' % (x_axis.position(m.input_size),
+                                   y_axis.position(m.time))
+                    for m in visible)
+    width = 2.5 if method.main else 1.2
+    out.append('<polyline points="%s" fill="none" stroke="%s" '
+               'stroke-width="%.1f"/>' % (path, color, width))
+    for m in visible:
+      out.append('<circle cx="%.1f" cy="%.1f" r="2" fill="%s">'
+                 '<title>%s %s: %s</title></circle>'
+                 % (x_axis.position(m.input_size), y_axis.position(m.time),
+                    color, html.escape(method.name), m.input_size,
+                    formatTime(m.time)))
+    legend_y = top + 14 * i + 10
+    out.append('<line x1="%d" y1="%d" x2="%d" y2="%d" stroke="%s" '
+               'stroke-width="%.1f"/>'
+               % (right + 15, legend_y - 4, right + 35, legend_y - 4, color,
+                  width))
+    out.append('<text x="%d" y="%d">%s</text>'
+               % (right + 40, legend_y, html.escape(method.name)))
+
+  out.append('</svg>')
+  return '\n'.join(out)
+
+# Where each method is the fastest: consecutive input sizes with the same
+# winner are one row.
+def crossoverTable(chart):
+  xs = [m.input_size for m in chart.methods[0].measurements]
+  rows = []
+  for i, x in enumerate(xs):
+    winner = min(chart.methods, key=lambda method: method.measurements[i].time)
+    time = winner.measurements[i].time
+    if rows and rows[-1][2] == winner.name:
+      rows[-1][1] = x
       continue
-    for m, baseline in zip(ms, measurements[baseline_name]):
-      assert(m.input_size == baseline.input_size)
-      m.time - baseline.time
-    methods.append(Method(name, ms))
-
-  del measurements[baseline_name]
-
-  return (title, methods)
-
-def drawPlot(title, methods):
-  traces = []
-  for method in methods:
-    input_sizes = map(lambda m : m.input_size, method.measurements)
-    times = map(lambda m: m.time, method.measurements)
-    line = dict( width = 1)
-    if method.main:
-      line['width'] = 2
-
-    trace = Scatter(x = input_sizes,
-                    y = times,
-                    mode = 'lines',
-                    name = method.name,
-                    line = line
-                    )
-    traces.append(trace)
-
-  data = plotly.graph_objs.Data(traces)
-  layout = {}
-  layout['title'] = \
-    '<b>Benchmarking flat_set<int>::insert(first, last)</b><br>' + \
-    'set size : ' + str(title.set_size) + \
-    ' value distribution(1..' + str(title.distribution_size) + ')'
-
-  layout['xaxis'] = dict(title='distance(first, last)')
-  layout['yaxis'] = dict(title='ns')
-
-  return plotly.plotly.plot(
-    dict(data=data, layout=layout),
-    filename = 'flat_set_insert_'+ str(title.set_size) + '_'\
-                                 + str(title.distribution_size),
-    fileopt = 'overwrite',
-    auto_open = False,
-  )
+    rows.append([x, x, winner.name, time])
+
+  out = ['<table><tr><th>input sizes</th><th>fastest</th>'
+         '<th>time at start</th></tr>']
+  for first, last, name, time in rows:
+    sizes = str(first) if first == last else '%d .. %d' % (first, last)
+    out.append('<tr><td>%s</td><td>%s</td><td>%s</td></tr>'
+               % (sizes, html.escape(name), formatTime(time)))
+  out.append('</table>')
+  return '\n'.join(out)
+
+def contextTable(context):
+  out = ['<table>']
+  for key in sorted(context):
+    value = context[key]
+    if isinstance(value, (dict, list)):
+      continue
+    out.append('<tr><th>%s</th><td>%s</td></tr>'
+               % (html.escape(key), html.escape(str(value))))
+  out.append('</table>')
+  return '\n'.join(out)
+
+def drawReport(sections, baseline_name, log_x, log_y):
+  out = ['<!DOCTYPE html>', '<html><head><meta charset="utf-8">',
+         '<title>Benchmark results</title>',
+         '<style>body { font-family: sans-serif; } '
+         'table { border-collapse: collapse; margin: 8px 0 24px; } '
+         'td, th { border: 1px solid #ccc; padding: 2px 8px; '
+         'text-align: left; }</style>',
+         '</head><body>']
+  for path, loaded in sections:
+    charts, no_args = parseJson(loaded, baseline_name)
+    out.append('<h1>%s</h1>' % html.escape(path))
+    context = dict(loaded.get('context', {}))
+    # Older bulk insert outputs have the workload in the baseline.
+    for json_input in loaded['benchmarks']:
+      context.update(json_input.get('extra_data', {}))
+    out.append(contextTable(context))
+    for chart in charts:
+      out.append('<h2>%s</h2>' % html.escape(chart.title))
+      if chart.subtracted:
+        out.append('<p>%s is subtracted from every time.</p>'
+                   % html.escape(baseline_name))
+      out.append(drawSvg(chart, log_x, log_y))
+      if len(chart.methods) > 1:
+        out.append(crossoverTable(chart))
+    if no_args:
+      out.append('<h2>Without arguments</h2><table>')
+      for name, time in no_args:
+        out.append('<tr><td>%s</td><td>%s</td></tr>'
+                   % (html.escape(name), formatTime(time)))
+      out.append('</table>')
+  out.append('</body></html>')
+  return '\n'.join(out)
 
 if __name__ == "__main__":
-  options_parser = argparse.ArgumentParser( \
-        description='Comparing performance of different implementations.')
+  options_parser = argparse.ArgumentParser(
+      description='Comparing performance of different implementations.')
 
   options_parser.add_argument('--benchmarks_result_json',
-                               dest='benchmarks_result_json',
-                               required=True)
+                              dest='benchmarks_result_json',
+                              nargs='+',
+                              required=True)
   options_parser.add_argument('--baseline_name',
-                               dest='baseline_name',
-                               default='baseline')
+                              dest='baseline_name',
+                              default='baseline')
+  options_parser.add_argument('--output', default='benchmarks.html')
+  options_parser.add_argument('--log_x', action='store_true')
+  options_parser.add_argument('--log_y', action='store_true')
   options = options_parser.parse_args()
-  baseline_name = options.baseline_name
-  loaded_benchmarks = json.load(open(options.benchmarks_result_json))
-
-  title, methods = parseJson(loaded_benchmarks, baseline_name)
-  print drawPlot(title, methods)
 
+  sections = []
+  for path in options.benchmarks_result_json:
+    with open(path) as f:
+      sections.append((path, json.load(f)))
 
+  with open(options.output, 'w') as f:
+    f.write(drawReport(sections, options.baseline_name, options.log_x,
+                       options.log_y))
+  print(options.output)
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Runs benchmark binaries and collects their results in one directory.
+
+Every binary writes <output_dir>/<binary name>.json, its console output
+goes to <binary name>.log next to it. A binary that fails does not stop
+the others, the script exits with 1 at the end instead. Afterwards the
+results are drawn into <output_dir>/benchmarks.html.
+
+  run_benchmarks.py --output_dir results build/benchmarks/*_benchmark \\
+      --benchmark_args='--benchmark_repetitions=5'
+
+The build's run_benchmarks target does this for all of the benchmarks.
+"""
+
+import argparse
+import os
+import shlex
+import subprocess
+import sys
+import time
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+
+def benchmarkName(binary):
+  return os.path.splitext(os.path.basename(binary))[0]
+
+def runBenchmark(binary, output_dir, benchmark_args):
+  name = benchmarkName(binary)
+  json_path = os.path.join(output_dir, name + '.json')
+  log_path = os.path.join(output_dir, name + '.log')
+  command = [os.path.abspath(binary),
+             '--benchmark_out=' + json_path,
+             '--benchmark_out_format=json'] + benchmark_args
+
+  sys.stdout.write('%s: running\n' % name)
+  sys.stdout.flush()
+  start = time.time()
+  with open(log_path, 'w') as log:
+    try:
+      returncode = subprocess.call(command, stdout=log,
+                                   stderr=subprocess.STDOUT)
+    except OSError as e:
+      log.write('%s\n' % e)
+      returncode = -1
+  ok = returncode == 0 and os.path.exists(json_path)
+  sys.stdout.write('%s: %s in %.1fs, log in %s\n' %
+                   (name, 'done' if ok else 'FAILED (%d)' % returncode,
+                    time.time() - start, log_path))
+  return json_path if ok else None
+
+def drawReport(jsons, output_dir):
+  output = os.path.join(output_dir, 'benchmarks.html')
+  command = [sys.executable, os.path.join(SCRIPT_DIR, 'draw_benchmark_plot.py'),
+             '--output', output, '--benchmarks_result_json'] + jsons
+  if subprocess.call(command) != 0:
+    return False
+  sys.stdout.write('report in %s\n' % output)
+  return True
+
+if __name__ == '__main__':
+  options_parser = argparse.ArgumentParser(
+      description='Runs benchmark binaries, results go to one directory.')
+  options_parser.add_argument('binaries', nargs='+')
+  options_parser.add_argument('--output_dir', default='benchmark_results')
+  options_parser.add_argument('--benchmark_args', default='',
+                              help='passed to every binary, split like a '
+                                   'shell would')
+  options_parser.add_argument('--no_report', action='store_true',
+                              help='do not draw benchmarks.html')
+  options = options_parser.parse_args()
+
+  if not os.path.isdir(options.output_dir):
+    os.makedirs(options.output_dir)
+  benchmark_args = shlex.split(options.benchmark_args)
+
+  jsons = []
+  failed = []
+  for binary in options.binaries:
+    json_path = runBenchmark(binary, options.output_dir, benchmark_args)
+    if json_path:
+      jsons.append(json_path)
+    else:
+      failed.append(benchmarkName(binary))
+
+  # Empty when the filter matched nothing in a binary.
+  jsons = [j for j in jsons if os.path.getsize(j) > 0]
+  if jsons and not options.no_report:
+    if not drawReport(jsons, options.output_dir):
+      failed.append('report')
+
+  if failed:
+    sys.stderr.write('failed: %s\n' % ', '.join(failed))
+  sys.exit(1 if failed else 0)
@@ -0,0 +1,69 @@
+#include "benchmarks/allocation_tracking.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+struct fake_state {
+  std::int64_t iterations() const { return 2; }
+  std::map<std::string, double> counters;
+};
+
+}  // namespace
+
+TEST_CASE("allocation_tracking", "[allocation_tracking]") {
+  // Sanitizer builds keep their own allocator.
+  if (!helpers::allocation_tracking::enabled())
+    return;
+
+  helpers::allocation_tracker tracker;
+  {
+    std::vector<char> v(1000);
+    auto p = std::make_unique<std::int64_t>(1);
+    CHECK(*p == 1);
+  }
+  void* raw = std::malloc(500);
+  raw = std::realloc(raw, 2000);
+  std::free(raw);
+
+  const auto stats = tracker.stats();
+  CHECK(stats.allocations >= 2);
+  CHECK(stats.bytes >= 1000 + sizeof(std::int64_t));
+#ifdef __GLIBC__
+  CHECK(stats.allocations >= 4);
+  CHECK(stats.bytes >= 1000 + sizeof(std::int64_t) + 500 + 2000);
+  CHECK(stats.peak_live_bytes >= 2000);
+  CHECK(helpers::allocation_tracking::live_bytes() <=
+        helpers::allocation_tracking::peak_live_bytes());
+#endif
+
+  fake_state state;
+  tracker.report(state);
+  CHECK(state.counters["heap_allocations"] ==
+        static_cast<double>(stats.allocations) / 2);
+  CHECK(state.counters.count("heap_peak_bytes") == 1);
+}
+
+TEST_CASE("report_allocations_of_one", "[allocation_tracking]") {
+  if (!helpers::allocation_tracking::enabled())
+    return;
+
+  // Live before, not part of the peak.
+  std::vector<char> kept(100000);
+  fake_state state;
+  helpers::report_allocations_of_one(state,
+                                     [] { std::vector<char> v(3000); });
+  CHECK(state.counters["heap_allocations"] == 1);
+  CHECK(state.counters["heap_bytes"] == 3000);
+#ifdef __GLIBC__
+  CHECK(state.counters["heap_peak_bytes"] >= 3000);
+  CHECK(state.counters["heap_peak_bytes"] < 100000);
+#endif
+}
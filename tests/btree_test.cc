@@ -0,0 +1,137 @@
+#include "benchmarks/btree.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+// Big enough to get 3 keys per node, so that the trees are deep.
+struct big_int {
+  big_int() = default;
+  big_int(int x) { data[0] = x; }
+
+  std::array<std::int64_t, 16> data = {};
+
+  friend bool operator<(const big_int& x, const big_int& y) {
+    return x.data[0] < y.data[0];
+  }
+  friend bool operator==(const big_int& x, const big_int& y) {
+    return x.data[0] == y.data[0];
+  }
+};
+
+template <typename T>
+std::vector<T> to_vector(const containers::btree_set<T>& c) {
+  std::vector<T> res;
+  c.for_each([&](const T& x) { res.push_back(x); });
+  return res;
+}
+
+template <typename T>
+void check_same(const containers::btree_set<T>& actual,
+                const std::set<T>& expected) {
+  REQUIRE(actual.size() == expected.size());
+  CHECK(to_vector(actual) == std::vector<T>(expected.begin(), expected.end()));
+}
+
+template <typename T, typename Make>
+void random_insert_erase(int range, int operations, Make make) {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, range);
+
+  containers::btree_set<T> actual;
+  std::set<T> expected;
+
+  for (int i = 0; i < operations; ++i) {
+    const T x = make(dis(g));
+    if (i % 3 == 0) {
+      REQUIRE(actual.erase(x) == expected.erase(x));
+    } else {
+      auto res = actual.insert(x);
+      REQUIRE(res.second == expected.insert(x).second);
+      REQUIRE(*res.first == x);
+    }
+  }
+  check_same(actual, expected);
+  for (int x = 0; x <= range; ++x)
+    CHECK(actual.contains(make(x)) == (expected.count(make(x)) == 1));
+
+  for (int x = 0; x <= range; ++x)
+    CHECK(actual.erase(make(x)) == expected.erase(make(x)));
+  CHECK(actual.empty());
+}
+
+}  // namespace
+
+TEST_CASE("btree_set_insert_erase", "[btree]") {
+  random_insert_erase<int>(2000, 20000, [](int x) { return x; });
+  random_insert_erase<big_int>(300, 5000, [](int x) { return big_int(x); });
+  random_insert_erase<std::string>(300, 5000,
+                                   [](int x) { return std::to_string(x); });
+}
+
+TEST_CASE("btree_set_sorted_unique", "[btree]") {
+  for (int size : {0, 1, 2, 3, 4, 7, 15, 16, 31, 100, 1000, 5000}) {
+    std::vector<big_int> input(static_cast<size_t>(size));
+    for (int i = 0; i < size; ++i)
+      input[static_cast<size_t>(i)] = 2 * i;
+
+    containers::btree_set<big_int> c(containers::sorted_unique, input.begin(),
+                                     input.end());
+    REQUIRE(c.size() == input.size());
+    CHECK(to_vector(c) == input);
+
+    // The tree is valid: inserting and erasing everything works.
+    for (int i = 0; i < size; ++i)
+      CHECK(c.insert(2 * i + 1).second);
+    for (int i = 0; i < 2 * size; ++i)
+      CHECK(c.erase(big_int(i)) == 1);
+    CHECK(c.empty());
+  }
+}
+
+TEST_CASE("btree_set_bulk_insert", "[btree]") {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, 10000);
+
+  containers::btree_set<int> actual;
+  std::set<int> expected;
+
+  for (size_t batch : {1u, 10u, 1000u, 3u, 5000u, 100u}) {
+    std::vector<int> input(batch);
+    std::generate(input.begin(), input.end(), [&] { return dis(g); });
+    actual.insert(input.begin(), input.end());
+    expected.insert(input.begin(), input.end());
+    check_same(actual, expected);
+  }
+
+  auto copy = actual;
+  copy.erase(*expected.begin());
+  CHECK(actual.contains(*expected.begin()));
+  CHECK(copy.size() + 1 == actual.size());
+}
+
+TEST_CASE("btree_set_move_only", "[btree]") {
+  std::vector<std::unique_ptr<int>> input;
+  for (int i = 0; i < 1000; ++i)
+    input.push_back(std::make_unique<int>(i));
+
+  containers::btree_set<std::unique_ptr<int>> c;
+  c.insert(std::make_move_iterator(input.begin()),
+           std::make_move_iterator(input.begin() + 500));
+  for (auto it = input.begin() + 500; it != input.end(); ++it)
+    CHECK(c.insert(std::move(*it)).second);
+  CHECK(c.size() == 1000);
+
+  int sum = 0;
+  c.for_each([&](const std::unique_ptr<int>& x) { sum += *x; });
+  CHECK(sum == 999 * 1000 / 2);
+}
@@ -0,0 +1,51 @@
+#include "benchmarks/buffered_flat_set.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+template <typename C>
+void random_inserts_and_lookups() {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, 20000);
+
+  std::vector<int> initial(1000);
+  std::generate(initial.begin(), initial.end(), [&] { return dis(g); });
+  std::set<int> expected(initial.begin(), initial.end());
+  initial.assign(expected.begin(), expected.end());
+
+  C actual(initial.begin(), initial.end());
+
+  for (int i = 0; i < 20000; ++i) {
+    const int x = dis(g);
+    if (i % 2) {
+      REQUIRE(actual.insert(x) == expected.insert(x).second);
+    } else {
+      REQUIRE(actual.contains(x) == (expected.count(x) == 1));
+    }
+    REQUIRE(actual.size() == expected.size());
+  }
+
+  std::vector<int> batch(3000);
+  std::generate(batch.begin(), batch.end(), [&] { return dis(g); });
+  actual.insert(batch.begin(), batch.end());
+  expected.insert(batch.begin(), batch.end());
+  REQUIRE(actual.size() == expected.size());
+
+  CHECK(actual.flat() == std::vector<int>(expected.begin(), expected.end()));
+}
+
+}  // namespace
+
+TEST_CASE("buffered_flat_set", "[buffered_flat_set]") {
+  random_inserts_and_lookups<containers::buffered_flat_set<int>>();
+}
+
+TEST_CASE("lsm_flat_set", "[buffered_flat_set]") {
+  random_inserts_and_lookups<containers::lsm_flat_set<int>>();
+}
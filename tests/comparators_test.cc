@@ -0,0 +1,112 @@
+#include "benchmarks/comparators.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "benchmarks/insert_algorithms.h"
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+using triple = std::array<std::int64_t, 3>;
+
+std::vector<triple> all_small_triples() {
+  std::vector<triple> res;
+  for (std::int64_t a = -2; a <= 2; ++a)
+    for (std::int64_t b = -2; b <= 2; ++b)
+      for (std::int64_t c = -2; c <= 2; ++c)
+        res.push_back({a, b, c});
+  return res;
+}
+
+using less_012 = comparators::lexicographic_less<comparators::element<0>,
+                                                 comparators::element<1>,
+                                                 comparators::element<2>>;
+
+using packed_less_012 = comparators::packed_lexicographic_less<
+    comparators::packed_field<comparators::element<0>, 3, -2>,
+    comparators::packed_field<comparators::element<1>, 3, -2>,
+    comparators::packed_field<comparators::element<2>, 3, -2>>;
+
+}  // namespace
+
+TEST_CASE("lexicographic_less", "[comparators]") {
+  const auto triples = all_small_triples();
+  for (const auto& x : triples)
+    for (const auto& y : triples)
+      REQUIRE(less_012{}(x, y) == (x < y));
+}
+
+TEST_CASE("lexicographic_less_field_order", "[comparators]") {
+  using less_20 = comparators::lexicographic_less<comparators::element<2>,
+                                                  comparators::element<0>>;
+  const auto triples = all_small_triples();
+  for (const auto& x : triples)
+    for (const auto& y : triples)
+      REQUIRE(less_20{}(x, y) ==
+              (std::tie(x[2], x[0]) < std::tie(y[2], y[0])));
+}
+
+TEST_CASE("lexicographic_less_not_arithmetic", "[comparators]") {
+  using record = std::tuple<std::string, int>;
+  using less_01 = comparators::lexicographic_less<comparators::element<0>,
+                                                  comparators::element<1>>;
+  std::vector<record> records = {
+      {"a", 1}, {"a", 2}, {"b", 0}, {"", 5}, {"ab", -1}, {"b", 0}};
+  for (const auto& x : records)
+    for (const auto& y : records)
+      REQUIRE(less_01{}(x, y) == (x < y));
+}
+
+TEST_CASE("packed_lexicographic_less", "[comparators]") {
+  static_assert(std::is_same<packed_less_012::key_type, std::uint64_t>::value,
+                "");
+  const auto triples = all_small_triples();
+  for (const auto& x : triples)
+    for (const auto& y : triples)
+      REQUIRE(packed_less_012{}(x, y) == (x < y));
+}
+
+TEST_CASE("packed_lexicographic_less_int128", "[comparators]") {
+  using wide_less = comparators::packed_lexicographic_less<
+      comparators::packed_field<comparators::element<0>, 64>,
+      comparators::packed_field<comparators::element<1>, 32>>;
+  static_assert(
+      std::is_same<wide_less::key_type, unsigned __int128>::value, "");
+
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> values = {
+      {0, 0}, {0, 1}, {1, 0}, {~std::uint64_t(0), 0},
+      {~std::uint64_t(0), ~std::uint32_t(0)}, {1ull << 63, 5}};
+  for (const auto& x : values)
+    for (const auto& y : values)
+      REQUIRE(wide_less{}(x, y) == (x < y));
+}
+
+TEST_CASE("lexicographic_less_bulk_insert", "[comparators]") {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(-2, 2);
+  std::vector<triple> input(200);
+  for (auto& x : input)
+    x = {dis(g), dis(g), dis(g)};
+
+  auto expected = input;
+  std::sort(expected.begin(), expected.end());
+  expected.erase(std::unique(expected.begin(), expected.end()),
+                 expected.end());
+
+  std::vector<triple> lexicographic;
+  bulk_insert::use_end_buffer_precise(lexicographic, input.begin(),
+                                      input.end(), less_012{});
+  CHECK(lexicographic == expected);
+
+  std::vector<triple> packed;
+  bulk_insert::use_end_buffer_precise(packed, input.begin(), input.end(),
+                                      packed_less_012{});
+  CHECK(packed == expected);
+}
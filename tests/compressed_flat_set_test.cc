@@ -0,0 +1,101 @@
+#include "benchmarks/compressed_flat_set.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+template <typename T>
+std::vector<T> to_vector(const containers::compressed_flat_set<T>& c) {
+  std::vector<T> res;
+  c.for_each([&](T x) { res.push_back(x); });
+  return res;
+}
+
+}  // namespace
+
+TEST_CASE("packed_round_trip", "[compressed_flat_set]") {
+  using namespace helpers::packed;
+
+  std::mt19937 g;
+  for (unsigned bits = 0; bits <= 32; ++bits) {
+    std::vector<std::uint32_t> in(c_block_size);
+    for (auto& x : in)
+      x = bits == 0 ? 0 : static_cast<std::uint32_t>(g()) >> (32 - bits);
+
+    std::vector<std::uint32_t> packed(packed_words(bits));
+    pack(in.data(), bits, packed.data());
+    std::vector<std::uint32_t> out(c_block_size);
+    unpack(packed.data(), bits, 7, out.data());
+
+    for (auto& x : in)
+      x += 7;
+    CHECK(in == out);
+  }
+}
+
+TEST_CASE("compressed_flat_set_insert", "[compressed_flat_set]") {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(-100000, 100000);
+
+  containers::compressed_flat_set<int> actual;
+  std::set<int> expected;
+
+  for (int i = 0; i < 100; ++i) {
+    std::vector<int> batch(static_cast<size_t>(i * 7 % 300));
+    std::generate(batch.begin(), batch.end(), [&] { return dis(g); });
+    actual.insert(batch.begin(), batch.end());
+    expected.insert(batch.begin(), batch.end());
+    REQUIRE(actual.size() == expected.size());
+  }
+
+  CHECK(to_vector(actual) ==
+        std::vector<int>(expected.begin(), expected.end()));
+  for (int x = -2000; x < 2000; ++x)
+    CHECK(actual.contains(x) == (expected.count(x) == 1));
+  for (int x : expected)
+    REQUIRE(actual.contains(x));
+}
+
+TEST_CASE("compressed_flat_set_extremes", "[compressed_flat_set]") {
+  using limits = std::numeric_limits<std::uint32_t>;
+  const std::vector<std::uint32_t> keys = {0, 1, limits::max() - 1,
+                                           limits::max()};
+  containers::compressed_flat_set<std::uint32_t> c(keys.begin(), keys.end());
+  CHECK(c.block_count() == 1);
+  CHECK(to_vector(c) == keys);
+  for (auto x : keys)
+    CHECK(c.contains(x));
+  CHECK(!c.contains(2));
+
+  std::vector<std::uint32_t> more = {5, limits::max(), 3};
+  c.insert(more.begin(), more.end());
+  CHECK(to_vector(c) ==
+        (std::vector<std::uint32_t>{0, 1, 3, 5, limits::max() - 1,
+                                    limits::max()}));
+}
+
+TEST_CASE("compressed_flat_set_dense", "[compressed_flat_set]") {
+  // Consecutive keys take 7 bits each.
+  std::vector<int> keys(128 * 100);
+  for (size_t i = 0; i < keys.size(); ++i)
+    keys[i] = static_cast<int>(i);
+
+  containers::compressed_flat_set<int> c(keys.begin(), keys.end());
+  CHECK(c.block_count() == 100);
+  CHECK(c.memory_bytes() < keys.size());
+
+  // Only the block with the new key changes.
+  std::vector<int> one = {static_cast<int>(keys.size()) + 1000};
+  c.insert(one.begin(), one.end());
+  CHECK(c.block_count() == 101);
+  CHECK(c.contains(static_cast<int>(keys.size()) + 1000));
+  CHECK(c.contains(5000));
+  CHECK(!c.contains(static_cast<int>(keys.size())));
+}
@@ -0,0 +1,69 @@
+#include "benchmarks/input_ring.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+// Runs max_iterations, the last batch can go over like in the library.
+struct fake_state {
+  bool KeepRunningBatch(std::int64_t n) {
+    CHECK(!paused);
+    if (iterations >= max_iterations)
+      return false;
+    iterations += n;
+    return true;
+  }
+  void PauseTiming() {
+    CHECK(!paused);
+    paused = true;
+  }
+  void ResumeTiming() {
+    CHECK(paused);
+    paused = false;
+  }
+
+  std::int64_t max_iterations = 10;
+  std::int64_t iterations = 0;
+  bool paused = false;
+};
+
+}  // namespace
+
+TEST_CASE("input_ring_size", "[input_ring]") {
+  CHECK(helpers::input_ring_size(0) == helpers::c_max_input_ring_size);
+  CHECK(helpers::input_ring_size(1) == helpers::c_max_input_ring_size);
+  CHECK(helpers::input_ring_size(helpers::c_input_ring_bytes / 10) == 10);
+  CHECK(helpers::input_ring_size(helpers::c_input_ring_bytes * 10) == 1);
+}
+
+TEST_CASE("run_on_copies", "[input_ring]") {
+  const std::vector<int> original{1, 2, 3};
+  fake_state state;
+  int calls = 0;
+  helpers::run_on_copies(state, original, 4, [&](std::vector<int>& copy) {
+    // Every call gets a fresh copy.
+    CHECK(copy == original);
+    CHECK(!state.paused);
+    copy.push_back(4);
+    ++calls;
+  });
+  CHECK(state.iterations == 12);
+  CHECK(calls == 12);
+}
+
+TEST_CASE("run_on_ring", "[input_ring]") {
+  fake_state state;
+  std::vector<int> ring(3);
+  int refills = 0;
+  helpers::run_on_ring(state, ring, [](int& x) { ++x; },
+                       [&](std::vector<int>& xs) {
+                         CHECK(state.paused);
+                         CHECK(xs == (std::vector<int>{1, 1, 1}));
+                         std::fill(xs.begin(), xs.end(), 0);
+                         ++refills;
+                       });
+  CHECK(refills == 4);
+}
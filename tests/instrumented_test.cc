@@ -0,0 +1,73 @@
+#include "benchmarks/instrumented.h"
+
+#include <algorithm>
+#include <initializer_list>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "benchmarks/insert_algorithms.h"
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+using key = helpers::instrumented<std::string>;
+using key_vec = std::vector<key, helpers::counting_allocator<key>>;
+
+key_vec make_keys(std::initializer_list<const char*> xs) {
+  key_vec res;
+  res.reserve(xs.size());
+  for (const char* x : xs)
+    res.emplace_back(x);
+  return res;
+}
+
+}  // namespace
+
+TEST_CASE("instrumented_operations", "[instrumented]") {
+  auto xs = make_keys({"b", "a"});
+
+  helpers::operation_counter counter;
+  const key copy = xs[0];
+  key moved = std::move(xs[1]);
+  using std::swap;
+  swap(xs[0], xs[1]);
+  CHECK(copy.value() == "b");
+  CHECK(moved.value() == "a");
+  CHECK(moved < copy);
+  CHECK(copy != moved);
+  xs.push_back(copy);  // reallocates
+
+  const auto counts = counter.counts();
+  CHECK(counts.copies == 2);
+  CHECK(counts.moves == 1 + 2);  // 2 moves on reallocation
+  CHECK(counts.swaps == 1);
+  CHECK(counts.comparisons == 2);
+  CHECK(counts.allocations == 1);
+}
+
+TEST_CASE("instrumented_algorithms", "[instrumented]") {
+  std::vector<int> xs(100);
+  std::iota(xs.begin(), xs.end(), 0);
+
+  helpers::operation_counter counter;
+  auto it = helpers::lower_bound_biased(xs.begin(), xs.end(), 3,
+                                        helpers::counting_predicate<>{});
+  CHECK(*it == 3);
+  const auto biased = counter.counts().comparisons;
+  CHECK(biased > 0);
+  CHECK(biased < 10);
+  CHECK(counter.counts().copies == 0);
+
+  auto c = make_keys({"a", "c", "e"});
+  const auto batch = make_keys({"b", "c", "d"});
+  helpers::operation_counter insert_counter;
+  bulk_insert::use_end_buffer_precise(c, batch.begin(), batch.end(),
+                                      std::less<>{});
+  CHECK(c.size() == 5);
+  CHECK(std::is_sorted(c.begin(), c.end()));
+  const auto counts = insert_counter.counts();
+  CHECK(counts.comparisons > 0);
+  CHECK(counts.copies >= 2);
+}
@@ -0,0 +1,129 @@
+#include "benchmarks/mapped_flat_set.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+// Removes the file when the test is over.
+struct temp_file {
+  explicit temp_file(const std::string& name)
+      : path("/tmp/mapped_flat_set_test_" + std::to_string(::getpid()) + "_" +
+             name) {}
+  ~temp_file() { std::remove(path.c_str()); }
+
+  std::string path;
+};
+
+std::vector<int> random_sorted(size_t size) {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(-1000000, 1000000);
+  std::set<int> res;
+  while (res.size() < size)
+    res.insert(dis(g));
+  return {res.begin(), res.end()};
+}
+
+}  // namespace
+
+TEST_CASE("mapped_flat_set", "[mapped_flat_set]") {
+  for (size_t size : {0, 1, 63, 64, 65, 1000, 10000}) {
+    for (bool with_index : {false, true}) {
+      const auto expected = random_sorted(size);
+      temp_file file("set");
+      containers::save_flat_set(file.path, expected, with_index);
+
+      const containers::mapped_flat_set<int> actual(file.path);
+      REQUIRE(actual.size() == expected.size());
+      CHECK(actual.has_index() == (with_index && size != 0));
+      CHECK(std::equal(actual.begin(), actual.end(), expected.begin()));
+
+      std::vector<int> queries = {-2000000, 2000000};
+      for (int x : expected) {
+        queries.push_back(x);
+        queries.push_back(x + 1);
+      }
+      for (int x : queries) {
+        const auto it = actual.lower_bound(x);
+        REQUIRE(it - actual.begin() ==
+                std::lower_bound(expected.begin(), expected.end(), x) -
+                    expected.begin());
+        CHECK(actual.contains(x) ==
+              std::binary_search(expected.begin(), expected.end(), x));
+      }
+    }
+  }
+}
+
+TEST_CASE("mapped_flat_map", "[mapped_flat_set]") {
+  const auto keys = random_sorted(1000);
+  std::vector<std::int64_t> values(keys.size());
+  std::transform(keys.begin(), keys.end(), values.begin(),
+                 [](int k) { return static_cast<std::int64_t>(k) * 3; });
+
+  temp_file file("map");
+  containers::save_flat_map(file.path, keys, values);
+  const containers::mapped_flat_map<int, std::int64_t> actual(file.path);
+
+  REQUIRE(actual.size() == keys.size());
+  for (int k : keys) {
+    const auto* v = actual.find(k);
+    REQUIRE(v);
+    CHECK(*v == static_cast<std::int64_t>(k) * 3);
+    CHECK(actual.value(actual.lower_bound(k)) == *v);
+  }
+  CHECK(actual.find(keys.back() + 1) == nullptr);
+}
+
+TEST_CASE("mapped_flat_set_bad_files", "[mapped_flat_set]") {
+  temp_file file("bad");
+  const std::vector<int> keys = {1, 2, 3};
+
+  CHECK_THROWS_AS(containers::mapped_flat_set<int>(file.path),
+                  const std::system_error&);
+
+  containers::save_flat_set(file.path, keys);
+  // Wrong element type or kind.
+  CHECK_THROWS_AS(containers::mapped_flat_set<std::int64_t>(file.path),
+                  const std::runtime_error&);
+  CHECK_THROWS_AS((containers::mapped_flat_map<int, int>(file.path)),
+                  const std::runtime_error&);
+
+  {
+    std::fstream f(file.path, std::ios::binary | std::ios::in | std::ios::out);
+    f.write("NOTASET", 7);
+  }
+  CHECK_THROWS_AS(containers::mapped_flat_set<int>(file.path),
+                  const std::runtime_error&);
+
+  {
+    std::ofstream f(file.path, std::ios::binary | std::ios::trunc);
+    f.write("FLATSET", 7);
+  }
+  CHECK_THROWS_AS(containers::mapped_flat_set<int>(file.path),
+                  const std::runtime_error&);
+
+  // count * sizeof(int) wraps around to the size of the three keys.
+  containers::save_flat_set(file.path, keys, /*with_index=*/false);
+  {
+    const std::uint64_t count = (std::uint64_t{1} << 62) + keys.size();
+    std::fstream f(file.path, std::ios::binary | std::ios::in | std::ios::out);
+    f.seekp(offsetof(helpers::disk::file_header, count));
+    f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  }
+  CHECK_THROWS_AS(containers::mapped_flat_set<int>(file.path),
+                  const std::runtime_error&);
+}
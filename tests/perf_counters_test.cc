@@ -0,0 +1,40 @@
+#include "benchmarks/perf_counters.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+struct fake_state {
+  std::int64_t iterations() const { return 10; }
+  std::map<std::string, double> counters;
+};
+
+}  // namespace
+
+TEST_CASE("perf_counters", "[perf_counters]") {
+  helpers::perf_counters counters;
+  counters.start();
+  volatile std::uint64_t sum = 0;
+  for (std::uint64_t i = 0; i < 100000; ++i)
+    sum = sum + i;
+  counters.stop();
+
+  fake_state state;
+  counters.report(state);
+
+  // Without counters (containers, VMs, strict perf_event_paranoid) nothing
+  // is reported, which is fine.
+  if (!counters.available()) {
+    CHECK(state.counters.empty());
+    return;
+  }
+  const auto instructions = state.counters.find("instructions");
+  if (instructions != state.counters.end())
+    CHECK(instructions->second >= 100000 / 10);
+  for (const auto& c : state.counters)
+    CHECK(c.second >= 0);
+}
@@ -0,0 +1,100 @@
+#include "benchmarks/rcu_flat_set.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+TEST_CASE("rcu_flat_set_insert", "[rcu_flat_set]") {
+  concurrency::rcu_flat_set<int> c(2);
+  auto reader = c.make_reader();
+
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, 1000);
+  std::set<int> expected;
+
+  for (int i = 0; i < 50; ++i) {
+    std::vector<int> batch(20);
+    std::generate(batch.begin(), batch.end(), [&] { return dis(g); });
+    c.insert(batch.begin(), batch.end());
+    expected.insert(batch.begin(), batch.end());
+
+    reader.read([&](const std::vector<int>& v) {
+      CHECK(v == std::vector<int>(expected.begin(), expected.end()));
+    });
+  }
+  for (int x = 0; x <= 1000; ++x)
+    CHECK(reader.contains(x) == (expected.count(x) == 1));
+
+  c.assign({1, 2, 3});
+  CHECK(c.size() == 3);
+  CHECK(reader.contains(2));
+  CHECK(!reader.contains(4));
+}
+
+TEST_CASE("rcu_flat_set_readers_slots", "[rcu_flat_set]") {
+  concurrency::rcu_flat_set<int> c(1);
+  {
+    auto reader = c.make_reader();
+    CHECK(!reader.contains(1));
+  }
+  // The slot is free again.
+  auto reader = c.make_reader();
+  c.assign({1});
+  CHECK(reader.contains(1));
+}
+
+TEST_CASE("rcu_flat_set_concurrent", "[rcu_flat_set]") {
+  constexpr int kReaders = 4;
+  concurrency::rcu_flat_set<int> c(kReaders);
+  std::vector<int> initial = {0, 1000000};
+  c.assign(initial);
+
+  std::atomic<bool> done{false};
+  std::atomic<int> failures{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < kReaders; ++i) {
+    readers.emplace_back([&] {
+      auto reader = c.make_reader();
+      while (!done.load()) {
+        // Every version is sorted and has the initial elements.
+        reader.read([&](const std::vector<int>& v) {
+          if (!std::is_sorted(v.begin(), v.end()) ||
+              !std::includes(v.begin(), v.end(), initial.begin(),
+                             initial.end()))
+            ++failures;
+        });
+      }
+    });
+  }
+
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(1, 999999);
+  for (int i = 0; i < 500; ++i) {
+    std::vector<int> batch(10);
+    std::generate(batch.begin(), batch.end(), [&] { return dis(g); });
+    c.insert(batch.begin(), batch.end());
+    if (i % 100 == 99)
+      c.assign(initial);
+  }
+  done = true;
+  for (auto& t : readers)
+    t.join();
+
+  CHECK(failures.load() == 0);
+}
+
+TEST_CASE("rcu_reader_slots_alignment", "[rcu_flat_set]") {
+  helpers::rcu_reader_slots slots(5);
+  for (size_t i = 0; i < 5; ++i) {
+    CHECK(reinterpret_cast<std::uintptr_t>(&slots[i]) % 64 == 0);
+    CHECK(slots[i].epoch.load() == helpers::c_rcu_idle);
+    CHECK(!slots[i].used.load());
+  }
+}
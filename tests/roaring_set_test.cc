@@ -0,0 +1,128 @@
+#include "benchmarks/roaring_set.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+using helpers::roaring::chunk_kind;
+
+template <typename T>
+std::vector<T> to_vector(const containers::roaring_set<T>& c) {
+  std::vector<T> res;
+  c.for_each([&](T x) { res.push_back(x); });
+  return res;
+}
+
+}  // namespace
+
+TEST_CASE("roaring_set_insert", "[roaring_set]") {
+  std::mt19937 g;
+  // Negative and positive keys over a few chunks.
+  std::uniform_int_distribution<> dis(-200000, 200000);
+
+  containers::roaring_set<int> actual;
+  std::set<int> expected;
+
+  for (int i = 0; i < 1000; ++i) {
+    const int x = dis(g);
+    CHECK(actual.insert(x) == expected.insert(x).second);
+  }
+  for (int i = 0; i < 20; ++i) {
+    std::vector<int> batch(static_cast<size_t>(i * 1000));
+    std::generate(batch.begin(), batch.end(), [&] { return dis(g); });
+    bulk_insert::roaring_union(actual, batch.begin(), batch.end(),
+                               std::less<>{});
+    expected.insert(batch.begin(), batch.end());
+    REQUIRE(actual.size() == expected.size());
+  }
+
+  CHECK(to_vector(actual) ==
+        std::vector<int>(expected.begin(), expected.end()));
+  for (int x = -1000; x < 1000; ++x)
+    CHECK(actual.contains(x) == (expected.count(x) == 1));
+}
+
+TEST_CASE("roaring_set_chunk_kinds", "[roaring_set]") {
+  containers::roaring_set<std::uint32_t> c;
+
+  // Sparse: array.
+  std::vector<std::uint32_t> sparse;
+  for (std::uint32_t i = 0; i < 1000; ++i)
+    sparse.push_back(i * 7);
+  c.insert(sparse.begin(), sparse.end());
+  CHECK(c.chunk_count(chunk_kind::array) == 1);
+
+  // Dense and scattered: bitmap.
+  std::vector<std::uint32_t> dense;
+  for (std::uint32_t i = 0; i < 65536; i += 3)
+    dense.push_back((1u << 16) + i);
+  c.insert(dense.begin(), dense.end());
+  CHECK(c.chunk_count(chunk_kind::bitmap) == 1);
+
+  // One long interval: runs.
+  std::vector<std::uint32_t> interval;
+  for (std::uint32_t i = 100; i < 60000; ++i)
+    interval.push_back((2u << 16) + i);
+  c.insert(interval.begin(), interval.end());
+  CHECK(c.chunk_count(chunk_kind::run) == 1);
+
+  // Filling the gaps of the bitmap makes it a single run.
+  std::vector<std::uint32_t> rest;
+  for (std::uint32_t i = 0; i < 65536; ++i)
+    rest.push_back((1u << 16) + i);
+  c.insert(rest.begin(), rest.end());
+  CHECK(c.chunk_count(chunk_kind::bitmap) == 0);
+  CHECK(c.chunk_count(chunk_kind::run) == 2);
+
+  CHECK(c.size() == sparse.size() + 65536 + interval.size());
+  CHECK(c.contains(7));
+  CHECK(!c.contains(8));
+  CHECK(c.contains((2u << 16) + 100));
+  CHECK(c.contains((2u << 16) + 59999));
+  CHECK(!c.contains((2u << 16) + 99));
+  CHECK(!c.contains((2u << 16) + 60000));
+  CHECK(c.memory_bytes() < 4 * c.size() / 10);
+
+  const auto all = to_vector(c);
+  CHECK(std::is_sorted(all.begin(), all.end()));
+  CHECK(all.size() == c.size());
+}
+
+TEST_CASE("roaring_set_kernels", "[roaring_set]") {
+  using namespace helpers::roaring;
+  std::vector<std::uint64_t> bitmap(c_bitmap_words, 0);
+  CHECK(bitmap_size(bitmap.data()) == 0);
+  CHECK(bitmap_run_count(bitmap.data()) == 0);
+
+  // A run across the word boundary and a single bit.
+  const std::vector<std::uint16_t> lows = {60, 61, 62, 63, 64, 65, 200};
+  set_bits(bitmap, lows.data(), lows.data() + lows.size());
+  CHECK(bitmap_size(bitmap.data()) == 7);
+  CHECK(bitmap_run_count(bitmap.data()) == 2);
+  CHECK(array_run_count(lows) == 2);
+
+  std::fill(bitmap.begin(), bitmap.end(), ~std::uint64_t(0));
+  CHECK(bitmap_size(bitmap.data()) == 65536);
+  CHECK(bitmap_run_count(bitmap.data()) == 1);
+
+  // Touching and overlapping runs merge.
+  const std::vector<run> runs = {{10, 20}, {30, 40}};
+  const std::vector<std::uint16_t> more = {0, 21, 25, 29, 35, 41, 65535};
+  const auto merged = runs_union(runs, more.data(), more.data() + more.size());
+  REQUIRE(merged.size() == 5);
+  CHECK(merged[0].start == 0);
+  CHECK(merged[1].start == 10);
+  CHECK(merged[1].last == 21);
+  CHECK(merged[2].start == 25);
+  CHECK(merged[2].last == 25);
+  CHECK(merged[3].start == 29);
+  CHECK(merged[3].last == 41);
+  CHECK(merged[4].start == 65535);
+  CHECK(runs_size(merged) == 1 + 12 + 1 + 13 + 1);
+}
@@ -0,0 +1,288 @@
+#include "benchmarks/parallel_selection.h"
+#include "benchmarks/selection.h"
+#include "benchmarks/simd_selection.h"
+#include "benchmarks/streaming_selection.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+using record = std::array<int, 2>;
+
+std::vector<record> random_records(size_t size) {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, static_cast<int>(size / 2));
+  std::vector<record> res(size);
+  int id = 0;
+  for (auto& x : res)
+    x = {dis(g), id++};
+  return res;
+}
+
+int first_field(const record& x) {
+  return x[0];
+}
+
+std::string first_field_as_string(const record& x) {
+  return std::to_string(x[0]);
+}
+
+template <typename Proj>
+void check_nth_element_by_key(Proj proj) {
+  for (size_t size : {1, 2, 3, 10, 100, 1000}) {
+    const auto input = random_records(size);
+    for (size_t k = 0; k < size; k += std::max<size_t>(1, size / 7)) {
+      auto actual = input;
+      auto m = actual.begin() + k;
+      selection::nth_element_by_key(actual.begin(), m, actual.end(), proj);
+
+      auto expected = input;
+      std::nth_element(expected.begin(), expected.begin() + k, expected.end(),
+                       helpers::compare_projected(std::less<>{}, proj));
+      REQUIRE(proj(*m) == proj(expected[k]));
+
+      CHECK(std::all_of(actual.begin(), m, [&](const record& x) {
+        return !(proj(*m) < proj(x));
+      }));
+      CHECK(std::all_of(m, actual.end(), [&](const record& x) {
+        return !(proj(x) < proj(*m));
+      }));
+      CHECK(std::is_permutation(actual.begin(), actual.end(), input.begin()));
+    }
+  }
+}
+
+template <typename T>
+std::vector<std::vector<T>> simd_selection_inputs(size_t size) {
+  std::mt19937 g;
+  std::vector<std::vector<T>> res;
+
+  std::vector<T> random(size);
+  std::uniform_int_distribution<> dis(-1000000, 1000000);
+  std::generate(random.begin(), random.end(), [&] { return T(dis(g)); });
+  res.push_back(random);
+
+  std::vector<T> few_values(size);
+  std::uniform_int_distribution<> few(0, 3);
+  std::generate(few_values.begin(), few_values.end(),
+                [&] { return T(few(g)); });
+  res.push_back(few_values);
+
+  res.push_back(std::vector<T>(size, T(7)));
+
+  std::vector<T> sorted(size);
+  std::iota(sorted.begin(), sorted.end(), T(0));
+  res.push_back(sorted);
+  res.push_back(std::vector<T>(sorted.rbegin(), sorted.rend()));
+
+  std::vector<T> organ_pipe(sorted.begin(), sorted.begin() + size / 2);
+  organ_pipe.insert(organ_pipe.end(), sorted.rbegin() + size / 2,
+                    sorted.rend());
+  res.push_back(organ_pipe);
+
+  return res;
+}
+
+template <typename T, typename Select>
+void check_simd_selection(Select select) {
+  for (size_t size : {0, 1, 7, 8, 9, 65, 100, 601, 1000, 20000}) {
+    for (const auto& input : simd_selection_inputs<T>(size)) {
+      auto sorted = input;
+      std::sort(sorted.begin(), sorted.end());
+      for (size_t k = 0; k < size; k += std::max<size_t>(1, size / 5)) {
+        auto actual = input;
+        T* f = actual.data();
+        T* m = f + k;
+        T* l = f + size;
+        select(f, m, l);
+        REQUIRE(*m == sorted[k]);
+        CHECK(std::all_of(f, m, [&](T x) { return !(*m < x); }));
+        CHECK(std::all_of(m, l, [&](T x) { return !(x < *m); }));
+        std::sort(f, l);
+        CHECK(actual == sorted);
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST_CASE("nth_element_by_key", "[selection]") {
+  check_nth_element_by_key(first_field);
+}
+
+TEST_CASE("nth_element_by_key_not_arithmetic", "[selection]") {
+  check_nth_element_by_key(first_field_as_string);
+}
+
+TEST_CASE("partial_sort_by_key", "[selection]") {
+  for (size_t size : {1, 2, 3, 10, 100, 1000}) {
+    const auto input = random_records(size);
+    for (size_t k = 0; k <= size; k += std::max<size_t>(1, size / 7)) {
+      auto actual = input;
+      selection::partial_sort_by_key(actual.begin(), actual.begin() + k,
+                                     actual.end(), first_field);
+
+      auto expected = input;
+      std::stable_sort(expected.begin(), expected.end());
+      for (size_t i = 0; i < k; ++i)
+        REQUIRE(actual[i][0] == expected[i][0]);
+      CHECK(std::is_permutation(actual.begin(), actual.end(), input.begin()));
+    }
+  }
+}
+
+TEST_CASE("heap_select", "[selection]") {
+  auto input = random_records(1000);
+  for (size_t k : {0, 1, 10, 500, 1000}) {
+    auto actual = input;
+    selection::heap_select(actual.begin(), actual.begin() + k, actual.end(),
+                           std::less<>{});
+    std::sort(actual.begin(), actual.begin() + k);
+
+    auto expected = input;
+    std::sort(expected.begin(), expected.end());
+    CHECK(std::equal(actual.begin(), actual.begin() + k, expected.begin()));
+  }
+}
+
+TEST_CASE("simd_nth_element", "[selection]") {
+  check_simd_selection<std::int64_t>(
+      [](auto f, auto m, auto l) { selection::simd_nth_element(f, m, l); });
+  check_simd_selection<double>(
+      [](auto f, auto m, auto l) { selection::simd_nth_element(f, m, l); });
+}
+
+TEST_CASE("introselect_scalar", "[selection]") {
+  check_simd_selection<std::int64_t>([](auto f, auto m, auto l) {
+    helpers::simd::introselect<helpers::simd::scalar_partitioner>(f, m, l);
+  });
+}
+
+TEST_CASE("median_of_medians", "[selection]") {
+  for (size_t size : {1, 5, 6, 100, 1001}) {
+    for (auto input : simd_selection_inputs<std::int64_t>(size)) {
+      auto pivot =
+          helpers::simd::median_of_medians<helpers::simd::scalar_partitioner>(
+              input.data(), input.data() + input.size());
+      auto less = std::count_if(input.begin(), input.end(),
+                                [&](std::int64_t x) { return x < pivot; });
+      auto greater = std::count_if(input.begin(), input.end(),
+                                   [&](std::int64_t x) { return pivot < x; });
+      CHECK(static_cast<size_t>(less) <= size - size * 3 / 10);
+      CHECK(static_cast<size_t>(greater) <= size - size * 3 / 10);
+    }
+  }
+}
+
+namespace {
+
+template <typename TopK>
+void check_streaming_top_k(size_t k) {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, 5000);
+  std::vector<int> input(10000);
+  std::generate(input.begin(), input.end(), [&] { return dis(g); });
+
+  auto expected = input;
+  std::sort(expected.begin(), expected.end(), std::greater<>{});
+  expected.resize(std::min(k, expected.size()));
+
+  TopK whole(k);
+  whole.push(input.begin(), input.end());
+  CHECK(whole.sorted() == expected);
+
+  TopK lhs(k);
+  TopK rhs(k);
+  lhs.push(input.begin(), input.begin() + 3000);
+  rhs.push(input.begin() + 3000, input.end());
+  lhs.merge(rhs);
+  CHECK(lhs.sorted() == expected);
+}
+
+}  // namespace
+
+TEST_CASE("top_k_heap", "[selection, streaming]") {
+  for (size_t k : {0, 1, 10, 1000, 20000})
+    check_streaming_top_k<selection::top_k_heap<int, std::greater<>>>(k);
+}
+
+TEST_CASE("top_k_buffer", "[selection, streaming]") {
+  for (size_t k : {0, 1, 10, 1000, 20000})
+    check_streaming_top_k<selection::top_k_buffer<int, std::greater<>>>(k);
+}
+
+TEST_CASE("kll_sketch", "[selection, streaming]") {
+  std::mt19937 g;
+  std::vector<int> input(200000);
+  std::iota(input.begin(), input.end(), 0);
+  std::shuffle(input.begin(), input.end(), g);
+
+  selection::kll_sketch<int> whole;
+  whole.push(input.begin(), input.end());
+  CHECK(whole.count() == input.size());
+  CHECK(whole.retained() < 1000);
+
+  std::vector<selection::kll_sketch<int>> shards;
+  const size_t shard_size = input.size() / 8;
+  for (size_t i = 0; i < 8; ++i) {
+    shards.emplace_back(200, i);
+    shards.back().push(input.begin() + i * shard_size,
+                       input.begin() + (i + 1) * shard_size);
+  }
+  for (size_t i = 1; i < shards.size(); ++i)
+    shards[0].merge(shards[i]);
+  CHECK(shards[0].count() == input.size());
+
+  // Values are ranks, so the rank error is a difference of values.
+  const double max_error = 0.02 * static_cast<double>(input.size());
+  for (double q : {0.0, 0.01, 0.25, 0.5, 0.9, 0.99, 1.0}) {
+    const double expected = q * static_cast<double>(input.size());
+    CHECK(std::abs(whole.quantile(q) - expected) <= max_error);
+    CHECK(std::abs(shards[0].quantile(q) - expected) <= max_error);
+  }
+}
+
+TEST_CASE("parallel_nth_element", "[selection]") {
+  concurrency::thread_pool pool(4);
+  const size_t size = 300000;
+
+  std::mt19937 g;
+  std::vector<std::vector<record>> inputs;
+  for (int max_value : {0, 3, 1000000}) {
+    std::uniform_int_distribution<> dis(0, max_value);
+    std::vector<record> input(size);
+    int id = 0;
+    for (auto& x : input)
+      x = {dis(g), id++};
+    inputs.push_back(input);
+  }
+  inputs.push_back(inputs.back());
+  std::sort(inputs.back().begin(), inputs.back().end());
+
+  for (const auto& input : inputs) {
+    auto sorted = input;
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t k : {size_t(0), size / 3, size - 1}) {
+      auto actual = input;
+      auto m = actual.begin() + k;
+      selection::parallel_nth_element(actual.begin(), m, actual.end(),
+                                      std::less<>{}, pool);
+      REQUIRE(*m == sorted[k]);
+      CHECK(std::all_of(actual.begin(), m,
+                        [&](const record& x) { return !(*m < x); }));
+      CHECK(std::all_of(m, actual.end(),
+                        [&](const record& x) { return !(x < *m); }));
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#include "benchmarks/sharded_flat_set.h"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+TEST_CASE("sharded_flat_set_insert", "[sharded_flat_set]") {
+  concurrency::thread_pool pool(3);
+  concurrency::sharded_flat_set<int> actual(8, std::less<>{}, pool);
+  std::set<int> expected;
+
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, 100000);
+  for (int i = 0; i < 100; ++i) {
+    std::vector<int> batch(static_cast<size_t>(i * 10));
+    std::generate(batch.begin(), batch.end(), [&] { return dis(g); });
+    actual.insert(batch.begin(), batch.end());
+    expected.insert(batch.begin(), batch.end());
+    REQUIRE(actual.size() == expected.size());
+  }
+
+  CHECK(actual.flat() == std::vector<int>(expected.begin(), expected.end()));
+  for (int x = 0; x < 2000; ++x)
+    CHECK(actual.contains(x) == (expected.count(x) == 1));
+}
+
+TEST_CASE("sharded_flat_set_rebalance", "[sharded_flat_set]") {
+  // Increasing keys all land in the last shard until it's recut.
+  concurrency::sharded_flat_set<int> c(4);
+  std::vector<int> initial(4000);
+  for (int i = 0; i < 4000; ++i)
+    initial[static_cast<size_t>(i)] = i;
+  c.assign(initial);
+
+  std::vector<int> batch(100);
+  for (int i = 0; i < 100; ++i) {
+    for (int j = 0; j < 100; ++j)
+      batch[static_cast<size_t>(j)] = 4000 + i * 100 + j;
+    c.insert(batch.begin(), batch.end());
+  }
+
+  CHECK(c.size() == 14000);
+  const auto all = c.flat();
+  CHECK(std::is_sorted(all.begin(), all.end()));
+  CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+  for (int x : {0, 3999, 4000, 13999})
+    CHECK(c.contains(x));
+  CHECK(!c.contains(14000));
+}
+
+TEST_CASE("sharded_flat_set_small", "[sharded_flat_set]") {
+  concurrency::sharded_flat_set<int> c(16);
+  c.assign({1, 5, 9});
+  std::vector<int> batch = {0, 5, 10, 3};
+  c.insert(batch.begin(), batch.end());
+  CHECK(c.flat() == (std::vector<int>{0, 1, 3, 5, 9, 10}));
+  CHECK(c.contains(0));
+  CHECK(!c.contains(2));
+}
+
+TEST_CASE("sharded_flat_set_concurrent", "[sharded_flat_set]") {
+  concurrency::thread_pool pool(2);
+  concurrency::sharded_flat_set<int> c(4, std::less<>{}, pool);
+
+  std::atomic<int> failures{0};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; ++t) {
+    writers.emplace_back([&c, &failures, t] {
+      std::vector<int> batch(50);
+      for (int i = 0; i < 100; ++i) {
+        for (int j = 0; j < 50; ++j)
+          batch[static_cast<size_t>(j)] = (i * 50 + j) * 4 + t;
+        c.insert(batch.begin(), batch.end());
+        if (!c.contains(batch.front()))
+          ++failures;
+      }
+    });
+  }
+  for (auto& w : writers)
+    w.join();
+
+  CHECK(failures.load() == 0);
+  const auto all = c.flat();
+  REQUIRE(all.size() == 20000);
+  for (int i = 0; i < 20000; ++i)
+    CHECK(all[static_cast<size_t>(i)] == i);
+}
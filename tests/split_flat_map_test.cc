@@ -0,0 +1,89 @@
+#include "benchmarks/split_flat_map.h"
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+template <typename K, typename V>
+void check_same(const containers::split_flat_map<K, V>& actual,
+                const std::map<K, V>& expected) {
+  REQUIRE(actual.size() == expected.size());
+  size_t i = 0;
+  for (const auto& x : expected) {
+    CHECK(actual.keys()[i] == x.first);
+    CHECK(actual.values()[i] == x.second);
+    ++i;
+  }
+}
+
+}  // namespace
+
+TEST_CASE("split_flat_map_emplace", "[split_flat_map]") {
+  containers::split_flat_map<int, std::string> actual;
+  std::map<int, std::string> expected;
+
+  for (int key : {5, 1, 3, 5, 0, 9, 1}) {
+    auto res = actual.emplace(key, std::to_string(key * 10));
+    auto expected_res = expected.emplace(key, std::to_string(key * 10));
+    CHECK(res.second == expected_res.second);
+    CHECK(*res.first == expected_res.first->second);
+  }
+  check_same(actual, expected);
+
+  CHECK(actual.contains(3));
+  CHECK(!actual.contains(4));
+  CHECK(*actual.find(9) == "90");
+  CHECK(actual.find(10) == nullptr);
+}
+
+TEST_CASE("split_flat_map_bulk_insert", "[split_flat_map]") {
+  using batch = std::vector<std::pair<int, int>>;
+  containers::split_flat_map<int, int> actual;
+  std::map<int, int> expected;
+
+  auto insert = [&](const batch& values) {
+    actual.insert(values.begin(), values.end());
+    expected.insert(values.begin(), values.end());
+    check_same(actual, expected);
+  };
+
+  insert({});
+  insert({{1, 1}, {2, 2}, {3, 3}});
+  insert({{1, 10}, {2, 20}});
+  insert({{6, 6}, {7, 7}, {6, 60}});
+  insert({{4, 4}, {6, 61}});
+  insert({{5, 5}, {1, 11}, {2, 21}});
+  insert({{9, 9}, {0, 0}, {8, 8}});
+
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, 1000);
+  for (int i = 0; i < 50; ++i) {
+    batch values(static_cast<size_t>(dis(g) % 50));
+    for (auto& x : values)
+      x = {dis(g), dis(g)};
+    insert(values);
+  }
+}
+
+TEST_CASE("split_flat_map_move_only", "[split_flat_map]") {
+  containers::split_flat_map<int, std::unique_ptr<int>> map;
+  map.emplace(2, std::make_unique<int>(2));
+
+  std::vector<std::pair<int, std::unique_ptr<int>>> values;
+  values.emplace_back(1, std::make_unique<int>(1));
+  values.emplace_back(2, std::make_unique<int>(20));
+  values.emplace_back(3, std::make_unique<int>(3));
+  map.insert(std::make_move_iterator(values.begin()),
+             std::make_move_iterator(values.end()));
+
+  REQUIRE(map.size() == 3);
+  for (int key : {1, 2, 3})
+    CHECK(**map.find(key) == key);
+}
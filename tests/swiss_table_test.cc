@@ -0,0 +1,158 @@
+#include "benchmarks/swiss_table.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+template <typename T>
+std::set<T> to_set(const containers::swiss_set<T>& c) {
+  std::set<T> res;
+  c.for_each([&](const T& x) { res.insert(x); });
+  return res;
+}
+
+// Every key collides, only h2 and the equality check tell them apart.
+struct bad_hash {
+  size_t operator()(int) const { return 42; }
+};
+
+}  // namespace
+
+TEST_CASE("swiss_set_insert_erase", "[swiss_table]") {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, 500);
+
+  containers::swiss_set<int> actual;
+  std::set<int> expected;
+
+  for (int i = 0; i < 10000; ++i) {
+    const int x = dis(g);
+    if (i % 3 == 0) {
+      CHECK(actual.erase(x) == expected.erase(x));
+    } else {
+      auto res = actual.insert(x);
+      CHECK(res.second == expected.insert(x).second);
+      CHECK(*res.first == x);
+    }
+    REQUIRE(actual.size() == expected.size());
+  }
+
+  CHECK(to_set(actual) == expected);
+  for (int x = 0; x <= 500; ++x)
+    CHECK(actual.contains(x) == (expected.count(x) == 1));
+}
+
+TEST_CASE("swiss_set_collisions", "[swiss_table]") {
+  containers::swiss_set<int, bad_hash> c;
+  for (int i = 0; i < 100; ++i)
+    CHECK(c.insert(i).second);
+  for (int i = 0; i < 100; i += 2)
+    CHECK(c.erase(i) == 1);
+  for (int i = 0; i < 100; ++i)
+    CHECK(c.contains(i) == (i % 2 == 1));
+}
+
+TEST_CASE("swiss_set_tombstones", "[swiss_table]") {
+  // Inserting and erasing at a constant size cleans up the deleted slots
+  // instead of growing.
+  containers::swiss_set<int> c;
+  for (int i = 0; i < 5; ++i)
+    c.insert(i);
+  const auto capacity = c.capacity();
+  for (int i = 5; i < 10000; ++i) {
+    c.insert(i);
+    c.erase(i - 5);
+  }
+  CHECK(c.size() == 5);
+  CHECK(c.capacity() == capacity);
+  for (int i = 9995; i < 10000; ++i)
+    CHECK(c.contains(i));
+}
+
+TEST_CASE("swiss_set_bulk_insert", "[swiss_table]") {
+  std::mt19937 g;
+  std::uniform_int_distribution<> dis(0, 1000);
+  std::vector<int> input(5000);
+  std::generate(input.begin(), input.end(), [&] { return dis(g); });
+
+  containers::swiss_set<int> actual;
+  actual.insert(input.begin(), input.begin() + 100);
+  actual.insert(input.begin() + 100, input.end());
+
+  CHECK(to_set(actual) == std::set<int>(input.begin(), input.end()));
+
+  auto copy = actual;
+  copy.erase(input[0]);
+  CHECK(actual.contains(input[0]));
+  CHECK(copy.size() + 1 == actual.size());
+}
+
+TEST_CASE("swiss_set_move_only", "[swiss_table]") {
+  std::vector<std::unique_ptr<int>> input;
+  for (int i = 0; i < 1000; ++i)
+    input.push_back(std::make_unique<int>(i));
+
+  containers::swiss_set<std::unique_ptr<int>> c;
+  c.insert(std::make_move_iterator(input.begin()),
+           std::make_move_iterator(input.end()));
+  CHECK(c.size() == 1000);
+
+  int sum = 0;
+  c.for_each([&](const std::unique_ptr<int>& x) { sum += *x; });
+  CHECK(sum == 999 * 1000 / 2);
+
+  auto moved = std::move(c);
+  CHECK(moved.size() == 1000);
+  CHECK(c.empty());
+}
+
+TEST_CASE("swiss_map", "[swiss_table]") {
+  containers::swiss_map<int, std::string> actual;
+  std::map<int, std::string> expected;
+
+  for (int key : {5, 1, 3, 5, 0, 9, 1}) {
+    auto res = actual.emplace(key, std::to_string(key * 10));
+    auto expected_res = expected.emplace(key, std::to_string(key * 10));
+    CHECK(res.second == expected_res.second);
+    CHECK(*res.first == expected_res.first->second);
+  }
+
+  std::vector<std::pair<int, std::string>> more = {
+      {3, "x"}, {100, "100"}, {-1, "-1"}, {100, "y"}};
+  actual.insert(more.begin(), more.end());
+  expected.insert(more.begin(), more.end());
+
+  REQUIRE(actual.size() == expected.size());
+  for (const auto& x : expected) {
+    const auto* found = actual.find(x.first);
+    REQUIRE(found);
+    CHECK(*found == x.second);
+  }
+  CHECK(actual.find(2) == nullptr);
+
+  *actual.find(9) = "nine";
+  CHECK(*actual.find(9) == "nine");
+}
+
+TEST_CASE("swiss_map_unique_ptr", "[swiss_table]") {
+  containers::swiss_map<int*, std::unique_ptr<int>> c;
+  std::vector<std::unique_ptr<int>> owners;
+  for (int i = 0; i < 100; ++i) {
+    auto p = std::make_unique<int>(i);
+    int* raw = p.get();
+    CHECK(c.emplace(raw, std::move(p)).second);
+    owners.push_back(std::make_unique<int>(i));
+    CHECK(!c.emplace(raw, std::move(owners.back())).second);
+    CHECK(owners.back() != nullptr);
+  }
+  CHECK(c.size() == 100);
+}
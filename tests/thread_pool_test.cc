@@ -0,0 +1,39 @@
+#include "benchmarks/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+TEST_CASE("parallel_for", "[thread_pool]") {
+  for (size_t size : {1, 2, 4}) {
+    concurrency::thread_pool pool(size);
+    CHECK(pool.size() == size);
+    for (size_t n : {0, 1, 3, 1000}) {
+      std::vector<int> calls(n);
+      pool.parallel_for(n, [&](size_t i) { ++calls[i]; });
+      CHECK(std::all_of(calls.begin(), calls.end(),
+                        [](int x) { return x == 1; }));
+    }
+  }
+}
+
+TEST_CASE("parallel_for_nested_and_concurrent", "[thread_pool]") {
+  concurrency::thread_pool pool(3);
+  std::atomic<size_t> sum{0};
+
+  auto nested_loop = [&] {
+    pool.parallel_for(10, [&](size_t i) {
+      pool.parallel_for(10, [&](size_t j) { sum += i * 10 + j; });
+    });
+  };
+
+  std::thread other(nested_loop);
+  nested_loop();
+  other.join();
+  CHECK(sum == 2 * (99 * 100 / 2));
+}
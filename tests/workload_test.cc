@@ -0,0 +1,145 @@
+#include "benchmarks/workload.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "third_party/catch/catch.h"
+
+namespace {
+
+size_t count_in(const std::vector<int>& sorted, const std::vector<int>& xs) {
+  return static_cast<size_t>(
+      std::count_if(xs.begin(), xs.end(), [&](int x) {
+        return std::binary_search(sorted.begin(), sorted.end(), x);
+      }));
+}
+
+}  // namespace
+
+TEST_CASE("workload_command_line", "[workload]") {
+  const std::string spec_path = "/tmp/workload_test_spec.txt";
+  {
+    std::ofstream out(spec_path);
+    out << "# comment\n"
+           "set_size = 100\n"
+           "distribution = zipfian  # trailing comment\n"
+           "key_type = string\n";
+  }
+
+  std::string args[] = {"binary",
+                        "--benchmark_filter=x",
+                        "--workload_spec=" + spec_path,
+                        "--workload_set_size=200",
+                        "--workload_sweep=geometric",
+                        "--benchmark_min_time=1"};
+  char* argv[6];
+  for (int i = 0; i < 6; ++i)
+    argv[i] = &args[i][0];
+  int argc = 6;
+
+  const auto s = workload::parse_command_line(argc, argv);
+  std::remove(spec_path.c_str());
+
+  CHECK(s.set_size == 200);
+  CHECK(s.distribution == workload::distribution_kind::zipfian);
+  CHECK(s.key == workload::key_kind::string);
+  CHECK(s.sweep == workload::sweep_kind::geometric);
+  CHECK(s.distribution_size == 1000000);
+
+  REQUIRE(argc == 3);
+  CHECK(std::string(argv[1]) == "--benchmark_filter=x");
+  CHECK(std::string(argv[2]) == "--benchmark_min_time=1");
+
+  workload::spec copy;
+  for (const auto& field : workload::describe(s))
+    workload::set_field(copy, field.first, field.second);
+  CHECK(workload::describe(copy) == workload::describe(s));
+  CHECK(copy.key == workload::key_kind::string);
+
+  workload::spec bad;
+  CHECK_THROWS_AS(workload::set_field(bad, "set_size", "ten"),
+                  const std::invalid_argument&);
+  CHECK_THROWS_AS(workload::set_field(bad, "distribution", "normal"),
+                  const std::invalid_argument&);
+  CHECK_THROWS_AS(workload::set_field(bad, "color", "red"),
+                  const std::invalid_argument&);
+
+  workload::spec wide;
+  wide.distribution_size = 3000000000;
+  CHECK_THROWS_AS(workload::check(wide), const std::invalid_argument&);
+  wide.key = workload::key_kind::int64;
+  CHECK_NOTHROW(workload::check(wide));
+  wide.key = workload::key_kind::string;
+  CHECK_NOTHROW(workload::check(wide));
+}
+
+TEST_CASE("workload_batch_sizes", "[workload]") {
+  workload::spec s;
+  s.min_batch = 10;
+  s.max_batch = 30;
+  s.step = 10;
+  CHECK(workload::batch_sizes(s) == (std::vector<size_t>{10, 20, 30}));
+
+  s.sweep = workload::sweep_kind::geometric;
+  s.min_batch = 1;
+  s.max_batch = 100;
+  s.factor = 1.5;
+  CHECK(workload::batch_sizes(s) ==
+        (std::vector<size_t>{1, 2, 3, 4, 6, 9, 13, 19, 28, 42, 63, 94}));
+}
+
+TEST_CASE("workload_distributions", "[workload]") {
+  workload::spec s;
+  s.set_size = 10000;
+  s.distribution_size = 100000;
+  constexpr size_t kBatch = 5000;
+
+  auto batch = [&](workload::distribution_kind d) {
+    s.distribution = d;
+    return workload::generator(s).batch<int>(kBatch);
+  };
+  auto in_range = [&](const std::vector<int>& xs) {
+    return std::all_of(xs.begin(), xs.end(), [&](int x) {
+      return x >= 1 && x <= static_cast<int>(s.distribution_size);
+    });
+  };
+
+  const auto set = workload::generator(s).set<int>();
+  REQUIRE(set.size() == s.set_size);
+  CHECK(std::is_sorted(set.begin(), set.end()));
+  CHECK(std::adjacent_find(set.begin(), set.end()) == set.end());
+
+  const auto uniform = batch(workload::distribution_kind::uniform);
+  CHECK(in_range(uniform));
+  CHECK(uniform == batch(workload::distribution_kind::uniform));
+
+  // Half of the zipfian keys are below sqrt(n) for exponent 1.
+  const auto zipfian = batch(workload::distribution_kind::zipfian);
+  CHECK(in_range(zipfian));
+  CHECK(std::count_if(zipfian.begin(), zipfian.end(),
+                      [](int x) { return x <= 316; }) > 2000);
+
+  const auto sequential = batch(workload::distribution_kind::sequential);
+  CHECK(in_range(sequential));
+  CHECK(std::adjacent_find(sequential.begin(), sequential.end(),
+                           [](int x, int y) { return y != x + 1 && y != 1; }) ==
+        sequential.end());
+
+  const auto clustered = batch(workload::distribution_kind::clustered);
+  CHECK(in_range(clustered));
+
+  const auto duplicates =
+      batch(workload::distribution_kind::mostly_duplicates);
+  CHECK(count_in(set, duplicates) > kBatch * 85 / 100);
+  const auto fresh = batch(workload::distribution_kind::mostly_new);
+  CHECK(count_in(set, fresh) < kBatch * 15 / 100);
+
+  s.distribution = workload::distribution_kind::uniform;
+  const auto strings = workload::generator(s).set<std::string>();
+  CHECK(std::is_sorted(strings.begin(), strings.end()));
+  CHECK(strings.front().size() == workload::c_string_key_digits);
+}